@@ -0,0 +1,313 @@
+/*
+ MIT License
+
+Copyright (c) 2020 HenryKing
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef ff_async_hpp
+#define ff_async_hpp
+
+/*
+ C++20 coroutine detection on top of ff_probe_begin / ff_probe_end:
+ 
+     FFType type = co_await ff::detect_async(executor, path);
+ 
+ the awaiter keeps the FFProbe and the read request in the coroutine frame, the executor only links
+ them into its queues, so a detection allocates nothing beyond the frame. matching runs inline when the
+ read completes, on the thread that completes it.
+ */
+
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <coroutine>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "ff_file_formats.h"
+
+namespace ff {
+
+/*
+ one header read: open path, read up to size bytes from offset 0 into data, set result
+ (bytes read, or -errno) and call complete(this). intrusive, owned by the caller
+ */
+struct read_op {
+    const char* path = nullptr;
+    unsigned char* data = nullptr;
+    size_t size = 0;
+    
+    long result = 0;
+    void (*complete)(read_op* op) = nullptr;
+    void* ctx = nullptr;
+    
+    read_op* next = nullptr;
+};
+
+/*
+ an executor issues the read of a read_op asynchronously, io_uring or a thread pool behind epoll alike.
+ complete may be called from inside submit
+ */
+template <class E>
+concept executor = requires(E& e, read_op& op) {
+    { e.submit(op) } -> std::same_as<void>;
+};
+
+template <executor E>
+class detect_awaiter {
+public:
+    detect_awaiter(E& ex, const char* path) : ex_(ex), path_(path) {}
+    
+    detect_awaiter(const detect_awaiter&) = delete;
+    detect_awaiter& operator=(const detect_awaiter&) = delete;
+    
+    // the extension alone may decide, then there is no read at all
+    bool await_ready() noexcept
+    {
+        if (path_ == nullptr || path_[0] == '\0') {
+            return true;
+        }
+        type_ = ff_probe_begin(&probe_, path_);
+        return type_ != FFTypeUnknown;
+    }
+    
+    // return false : the read completed inside submit, go on without suspending
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        handle_ = handle;
+        op_.path = path_;
+        op_.data = probe_.data;
+        op_.size = sizeof(probe_.data);
+        op_.complete = &detect_awaiter::on_read;
+        op_.ctx = this;
+        ex_.submit(op_);
+        return !done_.exchange(true, std::memory_order_acq_rel);
+    }
+    
+    FFType await_resume() const noexcept
+    {
+        return type_;
+    }
+    
+private:
+    static void on_read(read_op* op)
+    {
+        detect_awaiter* self = static_cast<detect_awaiter*>(op->ctx);
+        self->type_ = op->result >= 0 ? ff_probe_end(&self->probe_, (size_t)op->result) : FFTypeUnknown;
+        
+        // whoever comes second resumes
+        if (self->done_.exchange(true, std::memory_order_acq_rel)) {
+            self->handle_.resume();
+        }
+    }
+    
+    E& ex_;
+    const char* path_;
+    FFType type_ = FFTypeUnknown;
+    FFProbe probe_;
+    read_op op_;
+    std::coroutine_handle<> handle_;
+    std::atomic<bool> done_{false};
+};
+
+template <executor E>
+detect_awaiter<E> detect_async(E& ex, const char* path)
+{
+    return detect_awaiter<E>(ex, path);
+}
+
+/*
+ reference executor for epoll loops. regular files are always "ready" to epoll, so a fixed pool of
+ I/O threads does the blocking open / pread, and completions come back through an eventfd in the
+ loop's epoll set. complete, and so the coroutine, runs on the thread calling run_once
+ */
+class epoll_executor {
+public:
+    explicit epoll_executor(unsigned int io_threads = 4)
+    {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = event_fd_;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &event);
+        
+        for (unsigned int i = 0; i < (io_threads > 0 ? io_threads : 1); i++) {
+            threads_.emplace_back([this] { io_loop(); });
+        }
+    }
+    
+    ~epoll_executor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_all();
+        for (std::thread& thread : threads_) {
+            thread.join();
+        }
+        close(event_fd_);
+        close(epoll_fd_);
+    }
+    
+    epoll_executor(const epoll_executor&) = delete;
+    epoll_executor& operator=(const epoll_executor&) = delete;
+    
+    // add the server's own descriptors here, run_once hands their events to on_event
+    int epoll_fd() const
+    {
+        return epoll_fd_;
+    }
+    
+    // thread safe
+    void submit(read_op& op)
+    {
+        op.next = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            push(pending_head_, pending_tail_, &op);
+        }
+        cond_.notify_one();
+    }
+    
+    /*
+     wait up to timeout_ms (-1 : forever), resume the finished detections.
+     return the number of events handled
+     */
+    template <class F>
+    int run_once(int timeout_ms, F&& on_event)
+    {
+        epoll_event events[64];
+        int count = epoll_wait(epoll_fd_, events, 64, timeout_ms);
+        if (count < 0) {
+            return errno == EINTR ? 0 : -1;
+        }
+        
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.fd != event_fd_) {
+                on_event(events[i]);
+                continue;
+            }
+            
+            eventfd_t value = 0;
+            eventfd_read(event_fd_, &value);
+            
+            read_op* op = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                op = done_head_;
+                done_head_ = done_tail_ = nullptr;
+            }
+            while (op != nullptr) {
+                read_op* next = op->next;
+                op->complete(op);
+                op = next;
+            }
+        }
+        return count;
+    }
+    
+    int run_once(int timeout_ms)
+    {
+        return run_once(timeout_ms, [](epoll_event&) {});
+    }
+    
+private:
+    static void push(read_op*& head, read_op*& tail, read_op* op)
+    {
+        if (tail != nullptr) {
+            tail->next = op;
+        } else {
+            head = op;
+        }
+        tail = op;
+    }
+    
+    void io_loop()
+    {
+        for (;;) {
+            read_op* op = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [this] { return stop_ || pending_head_ != nullptr; });
+                if (pending_head_ == nullptr) {
+                    return;
+                }
+                op = pending_head_;
+                pending_head_ = op->next;
+                if (pending_head_ == nullptr) {
+                    pending_tail_ = nullptr;
+                }
+            }
+            
+            op->result = read_header(op);
+            op->next = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                push(done_head_, done_tail_, op);
+            }
+            eventfd_write(event_fd_, 1);
+        }
+    }
+    
+    static long read_header(read_op* op)
+    {
+        int fd = open(op->path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return -errno;
+        }
+        
+        ssize_t sz = pread(fd, op->data, op->size, 0);
+        long result = sz < 0 ? -errno : (long)sz;
+        close(fd);
+        return result;
+    }
+    
+    int epoll_fd_ = -1;
+    int event_fd_ = -1;
+    
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool stop_ = false;
+    read_op* pending_head_ = nullptr;
+    read_op* pending_tail_ = nullptr;
+    read_op* done_head_ = nullptr;
+    read_op* done_tail_ = nullptr;
+    
+    std::vector<std::thread> threads_;
+};
+
+static_assert(executor<epoll_executor>);
+
+} // namespace ff
+
+#endif /* ff_async_hpp */
@@ -0,0 +1,171 @@
+/*
+ MIT License
+
+Copyright (c) 2020 HenryKing
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+// latency of ff::detect_async under concurrent load, against blocking ff_get_type_from_file
+//
+//     gcc -c ff_file_formats.c ff_scan.c
+//     g++ -std=c++20 -O2 ff_async_bench.cpp ff_file_formats.o ff_scan.o -pthread -o ff_async_bench
+//     ff_async_bench <root> [concurrency] [io threads]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include <sys/timerfd.h>
+
+#include "ff_async.hpp"
+#include "ff_scan.h"
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+// fire and forget, the frame is the only allocation per coroutine
+struct detached {
+    struct promise_type {
+        detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+struct bench {
+    std::vector<std::string> paths;
+    size_t next = 0;
+    size_t running = 0;
+    std::vector<double> latencies_us;
+    size_t known = 0;
+};
+
+void collect(const char* path, const char* rel_path, const struct stat* st, void* ctx)
+{
+    (void)rel_path;
+    (void)st;
+    static_cast<bench*>(ctx)->paths.emplace_back(path);
+}
+
+detached worker(ff::epoll_executor& ex, bench& b)
+{
+    // only the loop thread touches bench, detections resume there
+    while (b.next < b.paths.size()) {
+        const char* path = b.paths[b.next++].c_str();
+        bench_clock::time_point start = bench_clock::now();
+        FFType type = co_await ff::detect_async(ex, path);
+        b.latencies_us.push_back(std::chrono::duration<double, std::micro>(bench_clock::now() - start).count());
+        b.known += type != FFTypeUnknown;
+    }
+    b.running--;
+}
+
+void report(const char* name, std::vector<double>& latencies_us, double seconds, double max_stall_us)
+{
+    if (latencies_us.empty()) {
+        printf("%s: no files\n", name);
+        return;
+    }
+    
+    std::sort(latencies_us.begin(), latencies_us.end());
+    auto at = [&](double q) { return latencies_us[(size_t)(q * (double)(latencies_us.size() - 1))]; };
+    printf("%-8s %8zu files %10.0f files/s  p50 %8.1f us  p99 %8.1f us  max %8.1f us  loop stall max %8.1f us\n",
+           name, latencies_us.size(), (double)latencies_us.size() / seconds, at(0.5), at(0.99), latencies_us.back(), max_stall_us);
+}
+
+} // namespace
+
+int main(int argc, const char* argv[])
+{
+    if (argc < 2) {
+        printf("Please supply the directory as the first argument!\n");
+        return 1;
+    }
+    
+    size_t concurrency = argc >= 3 ? (size_t)atoi(argv[2]) : 64;
+    unsigned int io_threads = argc >= 4 ? (unsigned int)atoi(argv[3]) : 4;
+    
+    bench b;
+    if (0 != ff_scan_shard(argv[1], 0, 1, collect, &b)) {
+        printf("Fail to scan the directory: %s!\n", argv[1]);
+        return 1;
+    }
+    
+    // blocking: every call stalls the loop thread for its whole latency
+    std::vector<double> blocking_us;
+    blocking_us.reserve(b.paths.size());
+    bench_clock::time_point start = bench_clock::now();
+    for (const std::string& path : b.paths) {
+        bench_clock::time_point t = bench_clock::now();
+        ff_get_type_from_file(path.c_str());
+        blocking_us.push_back(std::chrono::duration<double, std::micro>(bench_clock::now() - t).count());
+    }
+    double blocking_seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+    double blocking_stall = blocking_us.empty() ? 0 : *std::max_element(blocking_us.begin(), blocking_us.end());
+    report("blocking", blocking_us, blocking_seconds, blocking_stall);
+    
+    // async: concurrency coroutines in flight, a 1 ms timer measures how late the loop gets to it
+    ff::epoll_executor ex(io_threads);
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    itimerspec tick = {};
+    tick.it_interval.tv_nsec = 1000000;
+    tick.it_value.tv_nsec = 1000000;
+    timerfd_settime(timer_fd, 0, &tick, nullptr);
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = timer_fd;
+    epoll_ctl(ex.epoll_fd(), EPOLL_CTL_ADD, timer_fd, &event);
+    
+    b.latencies_us.reserve(b.paths.size());
+    start = bench_clock::now();
+    bench_clock::time_point last_tick = start;
+    double max_stall_us = 0;
+    
+    for (size_t i = 0; i < concurrency && b.next < b.paths.size(); i++) {
+        b.running++;
+        worker(ex, b);
+    }
+    while (b.running > 0) {
+        ex.run_once(-1, [&](epoll_event& e) {
+            uint64_t expirations = 0;
+            if (e.data.fd == timer_fd && sizeof(expirations) == read(timer_fd, &expirations, sizeof(expirations))) {
+                bench_clock::time_point now = bench_clock::now();
+                double late_us = std::chrono::duration<double, std::micro>(now - last_tick).count() - 1000.0 * (double)expirations;
+                max_stall_us = std::max(max_stall_us, late_us);
+                last_tick = now;
+            }
+        });
+    }
+    double async_seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+    close(timer_fd);
+    
+    report("async", b.latencies_us, async_seconds, max_stall_us);
+    printf("concurrency %zu, io threads %u, known types %zu\n", concurrency, io_threads, b.known);
+    return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ MIT License
+
+Copyright (c) 2020 HenryKing
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <math.h>
+
+#include "ff_entropy.h"
+
+#define FF_ENTROPY_HIGH     0.9 // of the largest entropy the sample size allows
+#define FF_ENTROPY_CONTROL  0.01 // control bytes allowed in text
+#define FF_ENTROPY_SPARSE   0.5 // share of the most common byte
+
+typedef struct _FFEntropyHistogram {
+    // 4 interleaved tables, so consecutive equal bytes do not wait on the same counter
+    unsigned int counts[4][256];
+    size_t total;
+}FFEntropyHistogram;
+
+static const char* g_ff_entropy_class_names[] = {
+    "unknown",
+    "high-entropy",
+    "text",
+    "binary",
+    "sparse",
+};
+
+//------------------------------------------------------------------------------------------------------
+
+static void _ff_entropy_count(FFEntropyHistogram* histogram, const unsigned char* binary_data, size_t data_len)
+{
+    size_t i = 0;
+    for (; i + 4 <= data_len; i += 4) {
+        histogram->counts[0][binary_data[i]]++;
+        histogram->counts[1][binary_data[i + 1]]++;
+        histogram->counts[2][binary_data[i + 2]]++;
+        histogram->counts[3][binary_data[i + 3]]++;
+    }
+    for (; i < data_len; i++) {
+        histogram->counts[0][binary_data[i]]++;
+    }
+    histogram->total += data_len;
+}
+
+static FFEntropyClass _ff_entropy_classify(const FFEntropyHistogram* histogram, FFEntropy* entropy)
+{
+    FFEntropy result = { FFEntropyUnknown, 0, 0, 0, histogram->total };
+    double n = (double)histogram->total;
+    if (histogram->total == 0) {
+        goto end;
+    }
+    
+    double expected = n / 256;
+    double sum = 0;
+    unsigned int max_count = 0;
+    size_t control = 0;
+    for (int b = 0; b < 256; b++) {
+        unsigned int c = histogram->counts[0][b] + histogram->counts[1][b] + histogram->counts[2][b] + histogram->counts[3][b];
+        if (c > 0) {
+            sum += c * log2((double)c);
+        }
+        if (c > max_count) {
+            max_count = c;
+        }
+        // everything below space except \t \n \f \r ESC
+        if ((b < 0x20 && b != 0x09 && b != 0x0A && b != 0x0C && b != 0x0D && b != 0x1B) || b == 0x7F) {
+            control += c;
+        }
+        result.chi_square += (c - expected) * (c - expected) / expected;
+    }
+    result.entropy = log2(n) - sum / n;
+    
+    double max_entropy = log2(n < 256 ? n : 256);
+    double normalized = max_entropy > 0 ? result.entropy / max_entropy : 0;
+    double dominant = max_count / n;
+    double control_ratio = control / n;
+    
+    if (dominant >= FF_ENTROPY_SPARSE) {
+        result.entropy_class = FFEntropySparse;
+        result.score = dominant;
+    } else if (control_ratio <= FF_ENTROPY_CONTROL && histogram->counts[0][0] + histogram->counts[1][0] + histogram->counts[2][0] + histogram->counts[3][0] == 0) {
+        result.entropy_class = FFEntropyText;
+        result.score = 1 - control_ratio;
+    } else if (normalized >= FF_ENTROPY_HIGH) {
+        result.entropy_class = FFEntropyHigh;
+        result.score = normalized;
+    } else {
+        result.entropy_class = FFEntropyBinary;
+        result.score = 1 - normalized;
+    }
+    
+end:
+    if (entropy != NULL) {
+        *entropy = result;
+    }
+    return result.entropy_class;
+}
+
+FFEntropyClass ff_get_entropy_from_data(unsigned char* binary_data, size_t data_len, FFEntropy* entropy)
+{
+    FFEntropyHistogram histogram;
+    memset(&histogram, 0, sizeof(histogram));
+    _ff_entropy_count(&histogram, binary_data, data_len);
+    return _ff_entropy_classify(&histogram, entropy);
+}
+
+FFEntropyClass ff_get_entropy_from_file(const char* file_path_and_name, size_t sample_len, FFEntropy* entropy)
+{
+    FFEntropyHistogram histogram;
+    memset(&histogram, 0, sizeof(histogram));
+    
+    FILE* file = fopen(file_path_and_name, "rb");
+    if (file == NULL) {
+        printf("Fail to open the file: %s!\n", file_path_and_name);
+        return _ff_entropy_classify(&histogram, entropy);
+    }
+    
+    unsigned char chunk[FF_ENTROPY_CHUNK];
+    size_t sz = fread(chunk, 1, FF_PROBE_SIZE, file);
+    _ff_entropy_count(&histogram, chunk, sz);
+    
+    // the rest of the sample in evenly spaced chunks after the probe window
+    if (sample_len > 0 && sz == FF_PROBE_SIZE && 0 == fseek(file, 0, SEEK_END)) {
+        long span = ftell(file) - FF_PROBE_SIZE;
+        size_t chunk_count = (sample_len + FF_ENTROPY_CHUNK - 1) / FF_ENTROPY_CHUNK;
+        
+        // a file shorter than the sample is read through
+        long step = span > (long)(chunk_count * FF_ENTROPY_CHUNK) ? span / (long)chunk_count : FF_ENTROPY_CHUNK;
+        for (size_t i = 0; i < chunk_count; i++) {
+            if (0 != fseek(file, FF_PROBE_SIZE + (long)i * step, SEEK_SET)) {
+                break;
+            }
+            sz = fread(chunk, 1, sizeof(chunk), file);
+            _ff_entropy_count(&histogram, chunk, sz);
+            if (sz < sizeof(chunk)) {
+                break;
+            }
+        }
+    }
+    
+    fclose(file);
+    return _ff_entropy_classify(&histogram, entropy);
+}
+
+const char* ff_get_entropy_class_name(FFEntropyClass entropy_class)
+{
+    if ((int)entropy_class < 0 || (int)entropy_class > FFEntropySparse) {
+        return g_ff_entropy_class_names[0];
+    }
+    return g_ff_entropy_class_names[(int)entropy_class];
+}
@@ -0,0 +1,73 @@
+/*
+ MIT License
+
+Copyright (c) 2020 HenryKing
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef ff_entropy_h
+#define ff_entropy_h
+
+#include "ff_file_formats.h"
+
+/*
+ coarse class of data without a known signature, from a byte histogram of the probe window
+ and an optional larger window sampled across the file
+ */
+
+typedef enum _FFEntropyClass {
+    FFEntropyUnknown = 0, // no data
+    FFEntropyHigh, // encrypted or compressed
+    FFEntropyText,
+    FFEntropyBinary, // structured binary
+    FFEntropySparse, // dominated by one byte value, e.g. zeros
+}FFEntropyClass;
+
+typedef struct _FFEntropy {
+    FFEntropyClass entropy_class;
+    double score; // 0 .. 1, how strongly the data shows its class
+    double entropy; // Shannon entropy, bits per byte
+    double chi_square; // against uniform bytes, 255 degrees of freedom
+    size_t sample_len;
+}FFEntropy;
+
+#define FF_ENTROPY_CHUNK    4096
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+FFEntropyClass ff_get_entropy_from_data(unsigned char* binary_data, size_t data_len, FFEntropy* entropy);
+
+/*
+ sample_len : 0 : only the probe window; else also read up to sample_len bytes in FF_ENTROPY_CHUNK chunks
+ spread evenly over the file
+ */
+FFEntropyClass ff_get_entropy_from_file(const char* file_path_and_name, size_t sample_len, FFEntropy* entropy);
+
+const char* ff_get_entropy_class_name(FFEntropyClass entropy_class);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ff_entropy_h */
@@ -105,13 +105,248 @@ static int _ff_check_features(unsigned char* binary_data, size_t data_len, const
     return 1;
 }
 
-FFType ff_get_type_from_file(const char* file_path_and_name)
+//------------------------------------------------------------------------------------------------------
+// SECOND STAGE
+// ISO-BMFF (MP4, MOV, M4x, JP2) and RIFF (WAV, AVI, WEBP) are box/chunk structures, so the fixed
+// offsets above can be fooled by a `free` box before `ftyp` or a brand that is only listed as
+// compatible. These walkers refine such matches. They never allocate and never look past data_len.
+
+#define FF_FOURCC(a, b, c, d) (((unsigned int)(a) << 24) | ((unsigned int)(b) << 16) | ((unsigned int)(c) << 8) | (unsigned int)(d))
+
+typedef struct _FFBrand {
+    unsigned int brand;
+    FFType type;
+}FFBrand;
+
+static const FFBrand g_ff_bmff_brands[] = {
+    {FF_FOURCC('M', '4', 'A', ' '), FFTypeM4A},
+    {FF_FOURCC('M', '4', 'B', ' '), FFTypeM4B},
+    {FF_FOURCC('M', '4', 'P', ' '), FFTypeM4P},
+    {FF_FOURCC('M', '4', 'V', ' '), FFTypeM4V},
+    {FF_FOURCC('M', '4', 'V', 'H'), FFTypeM4V},
+    {FF_FOURCC('M', '4', 'V', 'P'), FFTypeM4V},
+    {FF_FOURCC('q', 't', ' ', ' '), FFTypeMOV},
+    {FF_FOURCC('j', 'p', '2', ' '), FFTypeJP2},
+    {FF_FOURCC('J', 'P', '2', ' '), FFTypeJP2},
+    
+    {FF_FOURCC('m', 'p', '4', '1'), FFTypeMP4},
+    {FF_FOURCC('m', 'p', '4', '2'), FFTypeMP4},
+    {FF_FOURCC('m', 'p', '7', '1'), FFTypeMP4},
+    {FF_FOURCC('i', 's', 'o', 'm'), FFTypeMP4},
+    {FF_FOURCC('i', 's', 'o', '2'), FFTypeMP4},
+    {FF_FOURCC('i', 's', 'o', '4'), FFTypeMP4},
+    {FF_FOURCC('i', 's', 'o', '5'), FFTypeMP4},
+    {FF_FOURCC('i', 's', 'o', '6'), FFTypeMP4},
+    {FF_FOURCC('a', 'v', 'c', '1'), FFTypeMP4},
+    {FF_FOURCC('d', 'a', 's', 'h'), FFTypeMP4},
+    {FF_FOURCC('M', 'S', 'N', 'V'), FFTypeMP4},
+};
+
+static unsigned int _ff_read_be32(const unsigned char* p)
 {
-    size_t len = strlen(file_path_and_name);
-    if (len < 1) {
+    return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | (unsigned int)p[3];
+}
+
+static unsigned int _ff_read_le32(const unsigned char* p)
+{
+    return ((unsigned int)p[3] << 24) | ((unsigned int)p[2] << 16) | ((unsigned int)p[1] << 8) | (unsigned int)p[0];
+}
+
+// return 0 : false; 1 : true
+static int _ff_is_fourcc(const unsigned char* p)
+{
+    for (int i = 0; i < 4; i++) {
+        if (p[i] < 0x20 || p[i] > 0x7E) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static FFType _ff_type_by_brand(unsigned int brand)
+{
+    // NDAS, NDSC ... NDXS [Nero Digital]
+    if ((brand >> 16) == FF_FOURCC(0, 0, 'N', 'D')) {
+        return FFTypeMP4;
+    }
+    
+    for (size_t i = 0; i < sizeof(g_ff_bmff_brands)/sizeof(FFBrand); i++) {
+        if (g_ff_bmff_brands[i].brand == brand) {
+            return g_ff_bmff_brands[i].type;
+        }
+    }
+    return FFTypeUnknown;
+}
+
+// payload: major brand, minor version, compatible brands
+static FFType _ff_check_ftyp(const unsigned char* payload, size_t payload_len, FFType fast_type)
+{
+    if (payload_len < 4) {
+        return fast_type;
+    }
+    
+    FFType type = _ff_type_by_brand(_ff_read_be32(payload));
+    for (size_t i = 8; type == FFTypeUnknown && i + 4 <= payload_len; i += 4) {
+        type = _ff_type_by_brand(_ff_read_be32(payload + i));
+    }
+    return type == FFTypeUnknown ? fast_type : type;
+}
+
+static FFType _ff_walk_bmff(const unsigned char* binary_data, size_t data_len, FFType fast_type)
+{
+    size_t pos = 0;
+    while (pos + 8 <= data_len) {
+        unsigned long long size = _ff_read_be32(binary_data + pos);
+        unsigned int box = _ff_read_be32(binary_data + pos + 4);
+        size_t header = 8;
+        
+        if (size == 1) {
+            // 64 bit largesize
+            if (pos + 16 > data_len) {
+                break;
+            }
+            size = ((unsigned long long)_ff_read_be32(binary_data + pos + 8) << 32) | _ff_read_be32(binary_data + pos + 12);
+            header = 16;
+        } else if (size == 0) {
+            // box extends to the end of file
+            size = data_len - pos;
+        }
+        
+        if (size < header) {
+            return FFTypeUnknown;
+        }
+        
+        switch (box) {
+            case FF_FOURCC('f', 't', 'y', 'p'): {
+                size_t payload_len = data_len - pos - header;
+                if (size - header < payload_len) {
+                    payload_len = (size_t)(size - header);
+                }
+                return _ff_check_ftyp(binary_data + pos + header, payload_len, fast_type);
+            }
+                
+            case FF_FOURCC('f', 'r', 'e', 'e'):
+            case FF_FOURCC('s', 'k', 'i', 'p'):
+            case FF_FOURCC('w', 'i', 'd', 'e'):
+            case FF_FOURCC('p', 'n', 'o', 't'):
+            case FF_FOURCC('j', 'P', ' ', ' '):
+                if (size > data_len - pos) {
+                    return fast_type;
+                }
+                pos += (size_t)size;
+                break;
+                
+            case FF_FOURCC('m', 'o', 'o', 'v'):
+            case FF_FOURCC('m', 'd', 'a', 't'):
+                // QuickTime Movie without ftyp
+                return FFTypeMOV;
+                
+            default:
+                return fast_type;
+        }
+    }
+    
+    return fast_type;
+}
+
+static FFType _ff_walk_riff(const unsigned char* binary_data, size_t data_len, FFType fast_type)
+{
+    if (data_len < 12) {
+        return fast_type;
+    }
+    
+    unsigned int magic = _ff_read_be32(binary_data);
+    int is_rf64 = magic == FF_FOURCC('R', 'F', '6', '4') || magic == FF_FOURCC('B', 'W', '6', '4');
+    int is_big_endian = magic == FF_FOURCC('R', 'I', 'F', 'X');
+    if (magic != FF_FOURCC('R', 'I', 'F', 'F') && !is_big_endian && !is_rf64) {
+        return fast_type;
+    }
+    
+    FFType type = FFTypeUnknown;
+    switch (_ff_read_be32(binary_data + 8)) {
+        case FF_FOURCC('W', 'A', 'V', 'E'): type = FFTypeWAV; break;
+        case FF_FOURCC('A', 'V', 'I', ' '): type = FFTypeAVI; break;
+        case FF_FOURCC('W', 'E', 'B', 'P'): type = FFTypeWEBP; break;
+        default: return FFTypeUnknown;
+    }
+    
+    // RF64 / BW64 only carry WAVE
+    if (is_rf64 && type != FFTypeWAV) {
         return FFTypeUnknown;
     }
     
+    size_t pos = 12;
+    while (pos + 8 <= data_len) {
+        const unsigned char* chunk = binary_data + pos;
+        if (!_ff_is_fourcc(chunk)) {
+            return FFTypeUnknown;
+        }
+        
+        unsigned int chunk_id = _ff_read_be32(chunk);
+        if (pos == 12) {
+            if (type == FFTypeWEBP) {
+                int is_vp8 = chunk_id == FF_FOURCC('V', 'P', '8', ' ') || chunk_id == FF_FOURCC('V', 'P', '8', 'L') || chunk_id == FF_FOURCC('V', 'P', '8', 'X');
+                return is_vp8 ? type : FFTypeUnknown;
+            }
+            if (type == FFTypeAVI) {
+                int is_list = chunk_id == FF_FOURCC('L', 'I', 'S', 'T') || chunk_id == FF_FOURCC('J', 'U', 'N', 'K');
+                return is_list ? type : FFTypeUnknown;
+            }
+        }
+        
+        // WAVE: fmt must come before data
+        if (chunk_id == FF_FOURCC('f', 'm', 't', ' ')) {
+            return type;
+        }
+        if (chunk_id == FF_FOURCC('d', 'a', 't', 'a')) {
+            return FFTypeUnknown;
+        }
+        
+        size_t chunk_size = is_big_endian ? _ff_read_be32(chunk + 4) : _ff_read_le32(chunk + 4);
+        if (chunk_size > data_len - pos - 8) {
+            break;
+        }
+        pos += 8 + chunk_size + (chunk_size & 1);
+    }
+    
+    return type;
+}
+
+// run the walkers only where the fixed offsets are weak or ambiguous
+static FFType _ff_refine_type(FFType type, unsigned char* binary_data, size_t data_len)
+{
+    switch (type) {
+        case FFTypeJP2:
+        case FFTypeM4A:
+        case FFTypeM4B:
+        case FFTypeM4P:
+        case FFTypeM4V:
+        case FFTypeMOV:
+        case FFTypeMP4:
+            return _ff_walk_bmff(binary_data, data_len, type);
+            
+        case FFTypeWEBP:
+        case FFTypeWAV:
+        case FFTypeAVI:
+            return _ff_walk_riff(binary_data, data_len, type);
+            
+        case FFTypeUnknown:
+            if (data_len >= 8 && _ff_read_be32(binary_data + 4) == FF_FOURCC('f', 't', 'y', 'p')) {
+                return _ff_walk_bmff(binary_data, data_len, type);
+            }
+            // RIFX, RF64, BW64
+            return _ff_walk_riff(binary_data, data_len, type);
+            
+        default:
+            return type;
+    }
+}
+
+FFType ff_probe_begin(FFProbe* probe, const char* file_path_and_name)
+{
+    probe->ext_type = FFTypeUnknown;
+    
+    size_t len = strlen(file_path_and_name);
     size_t min_i = len > FF_MAX_EXT_LEN ? len - FF_MAX_EXT_LEN - 1 : 0;
     
     char ext[FF_MAX_EXT_LEN] = { 0 };
@@ -122,9 +357,6 @@ FFType ff_get_type_from_file(const char* file_path_and_name)
         }
     }
     
-    FFType type = FFTypeUnknown;
-    const FFFormat* cur_format = NULL;
-    
     if (ext[0] != '\0') {
         char c = 0;
         for (size_t i = 0; i < FF_MAX_EXT_LEN && ext[0] != '\0'; i++) {
@@ -134,6 +366,7 @@ FFType ff_get_type_from_file(const char* file_path_and_name)
             }
         }
         
+        const FFFormat* cur_format = NULL;
         for (size_t i = 1; i < FFTypeXCount; i++) {
             cur_format = g_ff_formats + i;
             if (0 == strcmp(ext, cur_format->ext)) {
@@ -141,26 +374,64 @@ FFType ff_get_type_from_file(const char* file_path_and_name)
                     return (FFType)i;
                 }
                 
-                type = (FFType)i;
+                probe->ext_type = (FFType)i;
                 break;
             }
-            cur_format = NULL;
         }
     }
     
+    return FFTypeUnknown;
+}
+
+// match with the type hinted by the filename extension first
+static FFType _ff_get_type_with_ext(FFType ext_type, unsigned char* binary_data, size_t data_len)
+{
+    FFType type = ext_type;
+    if (data_len > 0) {
+        const FFFormat* cur_format = type != FFTypeUnknown ? g_ff_formats + type : NULL;
+        if (cur_format != NULL && 1 == _ff_check_features(binary_data, data_len, cur_format)) {
+            type = _ff_refine_type(type, binary_data, data_len);
+        } else {
+            type = FFTypeUnknown;
+        }
+        
+        if (type == FFTypeUnknown) {
+            type = ff_get_type_from_data(binary_data, data_len);
+        }
+    }
+    
+    return type;
+}
+
+FFType ff_probe_end(FFProbe* probe, size_t data_len)
+{
+    if (data_len > sizeof(probe->data)) {
+        data_len = sizeof(probe->data);
+    }
+    return _ff_get_type_with_ext(probe->ext_type, probe->data, data_len);
+}
+
+FFType ff_get_type_from_file(const char* file_path_and_name)
+{
+    size_t len = strlen(file_path_and_name);
+    if (len < 1) {
+        return FFTypeUnknown;
+    }
+    
+    FFProbe probe;
+    FFType type = ff_probe_begin(&probe, file_path_and_name);
+    if (type != FFTypeUnknown) {
+        return type;
+    }
+    
     FILE* file = fopen(file_path_and_name, "r");
     if (file == NULL) {
         printf("Fail to open the file: %s!\n", file_path_and_name);
         return 0;
     }
 
-    unsigned char binary_data[100] = { 0 };
-    size_t sz = fread(binary_data, 1, sizeof(binary_data), file);
-    if (sz > 0) {
-        if (cur_format == NULL || 1 != _ff_check_features(binary_data, sz, cur_format)) {
-            type = ff_get_type_from_data(binary_data, sz);
-        }
-    }
+    size_t sz = fread(probe.data, 1, sizeof(probe.data), file);
+    type = ff_probe_end(&probe, sz);
     
     fclose(file);
     return type;
@@ -168,16 +439,21 @@ FFType ff_get_type_from_file(const char* file_path_and_name)
 
 FFType ff_get_type_from_data(unsigned char* binary_data, size_t data_len)
 {
+    // the ustar magic is stronger than any 2 or 3 byte signature the first member name may match
+    if (1 == _ff_check_features(binary_data, data_len, g_ff_formats + FFTypeTAR)) {
+        return FFTypeTAR;
+    }
+    
     const FFFormat* cur_format = NULL;
     for (size_t i = 1; i < FFTypeCount; i++) {
         cur_format = g_ff_formats + i;
         
         if (1 == _ff_check_features(binary_data, data_len, cur_format)) {
-            return (FFType)i;
+            return _ff_refine_type((FFType)i, binary_data, data_len);
         }
     }
     
-    return FFTypeUnknown;
+    return _ff_refine_type(FFTypeUnknown, binary_data, data_len);
 }
 
 const char* ff_get_ext_name_by_type(FFType type)
@@ -188,6 +464,293 @@ const char* ff_get_ext_name_by_type(FFType type)
     return g_ff_formats[(int)type].ext;
 }
 
+//------------------------------------------------------------------------------------------------------
+// METADATA
+
+static unsigned int _ff_read_be16(const unsigned char* p)
+{
+    return ((unsigned int)p[0] << 8) | (unsigned int)p[1];
+}
+
+static unsigned int _ff_read_le16(const unsigned char* p)
+{
+    return ((unsigned int)p[1] << 8) | (unsigned int)p[0];
+}
+
+static unsigned int _ff_read_le24(const unsigned char* p)
+{
+    return ((unsigned int)p[2] << 16) | ((unsigned int)p[1] << 8) | (unsigned int)p[0];
+}
+
+static int _ff_meta_png(const unsigned char* binary_data, size_t data_len, FFMeta* meta)
+{
+    if (data_len < 26 || _ff_read_be32(binary_data + 12) != FF_FOURCC('I', 'H', 'D', 'R')) {
+        return 0;
+    }
+    
+    // by color type : gray, -, RGB, palette, gray + alpha, -, RGBA
+    static const unsigned char channels[] = { 1, 0, 3, 1, 2, 0, 4 };
+    meta->width = _ff_read_be32(binary_data + 16);
+    meta->height = _ff_read_be32(binary_data + 20);
+    meta->bits = binary_data[24];
+    meta->channels = binary_data[25] < sizeof(channels) ? channels[binary_data[25]] : 0;
+    return 1;
+}
+
+static int _ff_meta_gif(const unsigned char* binary_data, size_t data_len, FFMeta* meta)
+{
+    if (data_len < 10) {
+        return 0;
+    }
+    
+    meta->width = _ff_read_le16(binary_data + 6);
+    meta->height = _ff_read_le16(binary_data + 8);
+    return 1;
+}
+
+static int _ff_meta_bmp(const unsigned char* binary_data, size_t data_len, FFMeta* meta)
+{
+    if (data_len < 26) {
+        return 0;
+    }
+    
+    // BITMAPCOREHEADER
+    if (_ff_read_le32(binary_data + 14) == 12) {
+        meta->width = _ff_read_le16(binary_data + 18);
+        meta->height = _ff_read_le16(binary_data + 20);
+        meta->bits = _ff_read_le16(binary_data + 24);
+        return 1;
+    }
+    
+    if (data_len < 30) {
+        return 0;
+    }
+    
+    // negative height : top-down rows
+    int height = (int)_ff_read_le32(binary_data + 22);
+    meta->width = _ff_read_le32(binary_data + 18);
+    meta->height = height < 0 ? 0u - (unsigned int)height : (unsigned int)height;
+    meta->bits = _ff_read_le16(binary_data + 28);
+    return 1;
+}
+
+static int _ff_meta_webp(const unsigned char* binary_data, size_t data_len, FFMeta* meta)
+{
+    if (data_len < 30) {
+        return 0;
+    }
+    
+    switch (_ff_read_be32(binary_data + 12)) {
+        case FF_FOURCC('V', 'P', '8', ' '):
+            // key frame start code
+            if (binary_data[23] != 0x9D || binary_data[24] != 0x01 || binary_data[25] != 0x2A) {
+                return 0;
+            }
+            meta->width = _ff_read_le16(binary_data + 26) & 0x3FFF;
+            meta->height = _ff_read_le16(binary_data + 28) & 0x3FFF;
+            return 1;
+            
+        case FF_FOURCC('V', 'P', '8', 'L'): {
+            if (binary_data[20] != 0x2F) {
+                return 0;
+            }
+            unsigned int bits = _ff_read_le32(binary_data + 21);
+            meta->width = (bits & 0x3FFF) + 1;
+            meta->height = ((bits >> 14) & 0x3FFF) + 1;
+            return 1;
+        }
+            
+        case FF_FOURCC('V', 'P', '8', 'X'):
+            meta->width = _ff_read_le24(binary_data + 24) + 1;
+            meta->height = _ff_read_le24(binary_data + 27) + 1;
+            return 1;
+            
+        default:
+            return 0;
+    }
+}
+
+static int _ff_meta_psd(const unsigned char* binary_data, size_t data_len, FFMeta* meta)
+{
+    if (data_len < 24) {
+        return 0;
+    }
+    
+    meta->channels = _ff_read_be16(binary_data + 12);
+    meta->height = _ff_read_be32(binary_data + 14);
+    meta->width = _ff_read_be32(binary_data + 18);
+    meta->bits = _ff_read_be16(binary_data + 22);
+    return 1;
+}
+
+// walk the markers up to SOFn, within data_len only
+static int _ff_meta_jpeg(const unsigned char* binary_data, size_t data_len, FFMeta* meta)
+{
+    size_t pos = 2;
+    while (pos + 4 <= data_len) {
+        if (binary_data[pos] != 0xFF) {
+            return 0;
+        }
+        
+        unsigned char marker = binary_data[pos + 1];
+        if (marker == 0xFF) {
+            // fill byte
+            pos++;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            // no length
+            pos += 2;
+            continue;
+        }
+        if (marker == 0xD9 || marker == 0xDA) {
+            // EOI, SOS : no frame header before the image data
+            return 0;
+        }
+        
+        // SOF0 - SOF15, but DHT, JPG, DAC
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            if (pos + 10 > data_len) {
+                return 0;
+            }
+            meta->bits = binary_data[pos + 4];
+            meta->height = _ff_read_be16(binary_data + pos + 5);
+            meta->width = _ff_read_be16(binary_data + pos + 7);
+            meta->channels = binary_data[pos + 9];
+            return 1;
+        }
+        
+        pos += 2 + _ff_read_be16(binary_data + pos + 2);
+    }
+    return 0;
+}
+
+static int _ff_meta_wav(const unsigned char* binary_data, size_t data_len, FFMeta* meta)
+{
+    int is_big_endian = data_len >= 4 && _ff_read_be32(binary_data) == FF_FOURCC('R', 'I', 'F', 'X');
+    unsigned int (*read16)(const unsigned char*) = is_big_endian ? _ff_read_be16 : _ff_read_le16;
+    unsigned int (*read32)(const unsigned char*) = is_big_endian ? _ff_read_be32 : _ff_read_le32;
+    
+    size_t pos = 12;
+    while (pos + 8 <= data_len) {
+        size_t chunk_size = read32(binary_data + pos + 4);
+        if (_ff_read_be32(binary_data + pos) == FF_FOURCC('f', 'm', 't', ' ')) {
+            if (pos + 8 + 16 > data_len) {
+                return 0;
+            }
+            meta->channels = read16(binary_data + pos + 10);
+            meta->sample_rate = read32(binary_data + pos + 12);
+            meta->bits = read16(binary_data + pos + 22);
+            return 1;
+        }
+        
+        if (chunk_size > data_len - pos - 8) {
+            return 0;
+        }
+        pos += 8 + chunk_size + (chunk_size & 1);
+    }
+    return 0;
+}
+
+static int _ff_meta_aiff(const unsigned char* binary_data, size_t data_len, FFMeta* meta)
+{
+    size_t pos = 12;
+    while (pos + 8 <= data_len) {
+        size_t chunk_size = _ff_read_be32(binary_data + pos + 4);
+        if (_ff_read_be32(binary_data + pos) == FF_FOURCC('C', 'O', 'M', 'M')) {
+            if (pos + 8 + 18 > data_len) {
+                return 0;
+            }
+            meta->channels = _ff_read_be16(binary_data + pos + 8);
+            meta->bits = _ff_read_be16(binary_data + pos + 14);
+            
+            // 80 bit extended float, the high 32 bits of the mantissa hold any real rate
+            int exponent = (int)(_ff_read_be16(binary_data + pos + 16) & 0x7FFF) - 16383;
+            unsigned int mantissa = _ff_read_be32(binary_data + pos + 18);
+            meta->sample_rate = exponent >= 0 && exponent < 32 ? mantissa >> (31 - exponent) : 0;
+            return 1;
+        }
+        
+        if (chunk_size > data_len - pos - 8) {
+            return 0;
+        }
+        pos += 8 + chunk_size + (chunk_size & 1);
+    }
+    return 0;
+}
+
+static int _ff_meta_flac(const unsigned char* binary_data, size_t data_len, FFMeta* meta)
+{
+    // STREAMINFO is always the first metadata block
+    if (data_len < 22 || (binary_data[4] & 0x7F) != 0) {
+        return 0;
+    }
+    
+    const unsigned char* info = binary_data + 8;
+    meta->sample_rate = ((unsigned int)info[10] << 12) | ((unsigned int)info[11] << 4) | (info[12] >> 4);
+    meta->channels = ((info[12] >> 1) & 0x07) + 1;
+    meta->bits = (((info[12] & 0x01) << 4) | (info[13] >> 4)) + 1;
+    return 1;
+}
+
+int ff_get_meta_from_data(FFType type, unsigned char* binary_data, size_t data_len, FFMeta* meta)
+{
+    memset(meta, 0, sizeof(FFMeta));
+    
+    switch (type) {
+        case FFTypePNG:  return _ff_meta_png(binary_data, data_len, meta);
+        case FFTypeGIF:  return _ff_meta_gif(binary_data, data_len, meta);
+        case FFTypeBMP:  return _ff_meta_bmp(binary_data, data_len, meta);
+        case FFTypeWEBP: return _ff_meta_webp(binary_data, data_len, meta);
+        case FFTypePSD:
+        case FFTypePSB:  return _ff_meta_psd(binary_data, data_len, meta);
+        case FFTypeJPEG:
+        case FFTypeJPG:  return _ff_meta_jpeg(binary_data, data_len, meta);
+        case FFTypeWAV:  return _ff_meta_wav(binary_data, data_len, meta);
+        case FFTypeAIFF: return _ff_meta_aiff(binary_data, data_len, meta);
+        case FFTypeFLAC: return _ff_meta_flac(binary_data, data_len, meta);
+        default:         return 0;
+    }
+}
+
+FFType ff_get_type_and_meta_from_file(const char* file_path_and_name, size_t probe_size, FFMeta* meta)
+{
+    memset(meta, 0, sizeof(FFMeta));
+    
+    size_t len = strlen(file_path_and_name);
+    if (len < 1) {
+        return FFTypeUnknown;
+    }
+    
+    FFProbe probe;
+    FFType type = ff_probe_begin(&probe, file_path_and_name);
+    if (type != FFTypeUnknown) {
+        return type;
+    }
+    
+    FILE* file = fopen(file_path_and_name, "rb");
+    if (file == NULL) {
+        printf("Fail to open the file: %s!\n", file_path_and_name);
+        return 0;
+    }
+    
+    if (probe_size < FF_PROBE_SIZE) {
+        probe_size = FF_PROBE_SIZE;
+    } else if (probe_size > FF_META_MAX_PROBE_SIZE) {
+        probe_size = FF_META_MAX_PROBE_SIZE;
+    }
+    
+    unsigned char binary_data[FF_META_MAX_PROBE_SIZE];
+    size_t sz = fread(binary_data, 1, probe_size, file);
+    
+    // match on the usual probe window, so the type does not depend on probe_size
+    type = _ff_get_type_with_ext(probe.ext_type, binary_data, sz < FF_PROBE_SIZE ? sz : FF_PROBE_SIZE);
+    ff_get_meta_from_data(type, binary_data, sz, meta);
+    
+    fclose(file);
+    return type;
+}
+
 //------------------------------------------------------------------------------------------------------
 // DOCUMENT
 const FFFeature g_ff_pdf[] = {
@@ -493,19 +1056,19 @@ const FFFeature g_ff_mp4[] = {
     {9, 3, 0x44},
     
     // mp7
-    {8, 20, 0x6d},
-    {9, 20, 0x70},
-    {10, 20, 0x37},
+    {8, 4, 0x6d},
+    {9, 4, 0x70},
+    {10, 4, 0x37},
     
     // avc1
-    {8, 21, 0x61},
-    {9, 21, 0x76},
-    {10, 21, 0x63},
+    {8, 5, 0x61},
+    {9, 5, 0x76},
+    {10, 5, 0x63},
     
     // drc1
-    {8, 22, 0x64},
-    {9, 22, 0x72},
-    {10, 22, 0x63},
+    {8, 6, 0x64},
+    {9, 6, 0x72},
+    {10, 6, 0x63},
 };
 
 const FFFeature g_ff_mp3[] = {
@@ -615,6 +1178,56 @@ const FFFeature g_ff_exe[] = {
     {1, FF_NEED, 0x5A},
 };
 
+//------------------------------------------------------------------------------------------------------
+// COMPRESSION
+const FFFeature g_ff_gz[] = {
+    {0, FF_NEED, 0x1F},
+    {1, FF_NEED, 0x8B},
+    {2, FF_NEED, 0x08},
+};
+
+const FFFeature g_ff_bz2[] = {
+    {0, FF_NEED, 0x42},
+    {1, FF_NEED, 0x5A},
+    {2, FF_NEED, 0x68},
+    
+    // block size 1 - 9
+    {3, 0, 0x31},
+    {3, 1, 0x32},
+    {3, 2, 0x33},
+    {3, 3, 0x34},
+    {3, 4, 0x35},
+    {3, 5, 0x36},
+    {3, 6, 0x37},
+    {3, 7, 0x38},
+    {3, 8, 0x39},
+};
+
+const FFFeature g_ff_xz[] = {
+    {0, FF_NEED, 0xFD},
+    {1, FF_NEED, 0x37},
+    {2, FF_NEED, 0x7A},
+    {3, FF_NEED, 0x58},
+    {4, FF_NEED, 0x5A},
+    {5, FF_NEED, 0x00},
+};
+
+const FFFeature g_ff_zst[] = {
+    {0, FF_NEED, 0x28},
+    {1, FF_NEED, 0xB5},
+    {2, FF_NEED, 0x2F},
+    {3, FF_NEED, 0xFD},
+};
+
+// ustar
+const FFFeature g_ff_tar[] = {
+    {257, FF_NEED, 0x75},
+    {258, FF_NEED, 0x73},
+    {259, FF_NEED, 0x74},
+    {260, FF_NEED, 0x61},
+    {261, FF_NEED, 0x72},
+};
+
 //------------------------------------------------------------------------------------------------------
 // DOCUMENT 2
 const FFFeature g_ff_ms_doc[] = {
@@ -704,6 +1317,13 @@ const FFFormat g_ff_formats[FFTypeXCount] = {
     // APPLICATION
     {"EXE",  sizeof(g_ff_exe)/sizeof(FFFeature), g_ff_exe},
     
+    // COMPRESSION
+    {"GZ",   sizeof(g_ff_gz)/sizeof(FFFeature), g_ff_gz},
+    {"BZ2",  sizeof(g_ff_bz2)/sizeof(FFFeature), g_ff_bz2},
+    {"XZ",   sizeof(g_ff_xz)/sizeof(FFFeature), g_ff_xz},
+    {"ZST",  sizeof(g_ff_zst)/sizeof(FFFeature), g_ff_zst},
+    {"TAR",  sizeof(g_ff_tar)/sizeof(FFFeature), g_ff_tar},
+    
     {"", 0,  NULL}, // padding
     
     // BY EXT NAME
@@ -78,6 +78,13 @@ typedef enum _FFType {
     // APPLICATION
     FFTypeEXE,
     
+    // COMPRESSION
+    FFTypeGZ,
+    FFTypeBZ2,
+    FFTypeXZ,
+    FFTypeZST,
+    FFTypeTAR,
+    
     FFTypeCount,
     
     // DOCUMENT 2
@@ -104,6 +111,29 @@ typedef enum _FFType {
     FFTypeXCount,
 }FFType;
 
+#define FF_PROBE_SIZE   512 // covers the ustar magic at 257
+
+/*
+ detection split around the header read, for event loops that must not block on fopen / fread
+ */
+typedef struct _FFProbe {
+    FFType ext_type;
+    unsigned char data[FF_PROBE_SIZE];
+}FFProbe;
+
+#define FF_META_MAX_PROBE_SIZE  (64 * 1024)
+
+/*
+ read from the same header as the type, 0 if the format does not carry it
+ */
+typedef struct _FFMeta {
+    unsigned int width;
+    unsigned int height;
+    unsigned int channels; // image components or audio channels
+    unsigned int bits; // per component or sample
+    unsigned int sample_rate;
+}FFMeta;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -111,12 +141,36 @@ extern "C" {
 FFType ff_get_type_from_file(const char* file_path_and_name);
 
 /*
- read 100 bytes from file with offset 0, as the params to invoke this function
+ resolve the filename extension, no I/O.
+ return the type if the extension alone decides it, else FFTypeUnknown: then read up to FF_PROBE_SIZE bytes
+ with offset 0 into probe->data with any async I/O (epoll, io_uring ...) and call ff_probe_end
+ */
+FFType ff_probe_begin(FFProbe* probe, const char* file_path_and_name);
+
+/*
+ match the bytes read into probe->data, data_len : bytes read
+ */
+FFType ff_probe_end(FFProbe* probe, size_t data_len);
+
+/*
+ read FF_PROBE_SIZE bytes from file with offset 0, as the params to invoke this function
  */
 FFType ff_get_type_from_data(unsigned char* binary_data, size_t data_len);
 
 const char* ff_get_ext_name_by_type(FFType type);
 
+/*
+ type and metadata from one read of probe_size bytes (FF_PROBE_SIZE .. FF_META_MAX_PROBE_SIZE).
+ the dimensions of PNG, GIF, BMP, WEBP, PSD and JPEG (when SOF is within probe_size), channels and
+ sample rate of WAV, AIFF and FLAC
+ */
+FFType ff_get_type_and_meta_from_file(const char* file_path_and_name, size_t probe_size, FFMeta* meta);
+
+/*
+ return 0 : no metadata; 1 : meta is filled
+ */
+int ff_get_meta_from_data(FFType type, unsigned char* binary_data, size_t data_len, FFMeta* meta);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,258 @@
+/*
+ MIT License
+
+Copyright (c) 2020 HenryKing
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ff_hash.h"
+
+#define FF_XXH_PRIME1   11400714785074694791ULL
+#define FF_XXH_PRIME2   14029467366897019727ULL
+#define FF_XXH_PRIME3   1609587929392839161ULL
+#define FF_XXH_PRIME4   9650029242287828579ULL
+#define FF_XXH_PRIME5   2870177450012600261ULL
+
+typedef struct _FFHash {
+    unsigned long long acc[4];
+    unsigned long long total;
+    unsigned char buffer[32];
+    size_t buffer_len;
+}FFHash;
+
+// reused by every call on the same thread
+static _Thread_local unsigned char g_ff_hash_buffer[FF_HASH_SMALL_FILE];
+
+//------------------------------------------------------------------------------------------------------
+// XXH64
+
+static unsigned long long _ff_hash_read64(const unsigned char* p)
+{
+    unsigned long long v = 0;
+    for (int i = 7; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+static unsigned long long _ff_hash_read32(const unsigned char* p)
+{
+    return ((unsigned long long)p[3] << 24) | ((unsigned long long)p[2] << 16) | ((unsigned long long)p[1] << 8) | p[0];
+}
+
+static unsigned long long _ff_hash_rotl(unsigned long long v, int r)
+{
+    return (v << r) | (v >> (64 - r));
+}
+
+static unsigned long long _ff_hash_round(unsigned long long acc, unsigned long long input)
+{
+    acc += input * FF_XXH_PRIME2;
+    acc = _ff_hash_rotl(acc, 31);
+    return acc * FF_XXH_PRIME1;
+}
+
+static unsigned long long _ff_hash_merge(unsigned long long acc, unsigned long long v)
+{
+    acc ^= _ff_hash_round(0, v);
+    return acc * FF_XXH_PRIME1 + FF_XXH_PRIME4;
+}
+
+static void _ff_hash_init(FFHash* hash)
+{
+    memset(hash, 0, sizeof(FFHash));
+    hash->acc[0] = FF_XXH_PRIME1 + FF_XXH_PRIME2;
+    hash->acc[1] = FF_XXH_PRIME2;
+    hash->acc[2] = 0;
+    hash->acc[3] = 0 - FF_XXH_PRIME1;
+}
+
+static void _ff_hash_stripe(FFHash* hash, const unsigned char* p)
+{
+    hash->acc[0] = _ff_hash_round(hash->acc[0], _ff_hash_read64(p));
+    hash->acc[1] = _ff_hash_round(hash->acc[1], _ff_hash_read64(p + 8));
+    hash->acc[2] = _ff_hash_round(hash->acc[2], _ff_hash_read64(p + 16));
+    hash->acc[3] = _ff_hash_round(hash->acc[3], _ff_hash_read64(p + 24));
+}
+
+static void _ff_hash_update(FFHash* hash, const unsigned char* binary_data, size_t data_len)
+{
+    hash->total += data_len;
+    
+    if (hash->buffer_len > 0) {
+        size_t fill = 32 - hash->buffer_len;
+        if (fill > data_len) {
+            fill = data_len;
+        }
+        memcpy(hash->buffer + hash->buffer_len, binary_data, fill);
+        hash->buffer_len += fill;
+        binary_data += fill;
+        data_len -= fill;
+        
+        if (hash->buffer_len < 32) {
+            return;
+        }
+        _ff_hash_stripe(hash, hash->buffer);
+        hash->buffer_len = 0;
+    }
+    
+    for (; data_len >= 32; binary_data += 32, data_len -= 32) {
+        _ff_hash_stripe(hash, binary_data);
+    }
+    
+    memcpy(hash->buffer, binary_data, data_len);
+    hash->buffer_len = data_len;
+}
+
+static unsigned long long _ff_hash_digest(const FFHash* hash)
+{
+    unsigned long long h = 0;
+    if (hash->total >= 32) {
+        h = _ff_hash_rotl(hash->acc[0], 1) + _ff_hash_rotl(hash->acc[1], 7) + _ff_hash_rotl(hash->acc[2], 12) + _ff_hash_rotl(hash->acc[3], 18);
+        for (int i = 0; i < 4; i++) {
+            h = _ff_hash_merge(h, hash->acc[i]);
+        }
+    } else {
+        h = FF_XXH_PRIME5;
+    }
+    h += hash->total;
+    
+    const unsigned char* p = hash->buffer;
+    size_t len = hash->buffer_len;
+    for (; len >= 8; p += 8, len -= 8) {
+        h ^= _ff_hash_round(0, _ff_hash_read64(p));
+        h = _ff_hash_rotl(h, 27) * FF_XXH_PRIME1 + FF_XXH_PRIME4;
+    }
+    if (len >= 4) {
+        h ^= _ff_hash_read32(p) * FF_XXH_PRIME1;
+        h = _ff_hash_rotl(h, 23) * FF_XXH_PRIME2 + FF_XXH_PRIME3;
+        p += 4;
+        len -= 4;
+    }
+    for (; len > 0; p++, len--) {
+        h ^= *p * FF_XXH_PRIME5;
+        h = _ff_hash_rotl(h, 11) * FF_XXH_PRIME1;
+    }
+    
+    h ^= h >> 33;
+    h *= FF_XXH_PRIME2;
+    h ^= h >> 29;
+    h *= FF_XXH_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+unsigned long long ff_hash_data(const unsigned char* binary_data, size_t data_len)
+{
+    FFHash hash;
+    _ff_hash_init(&hash);
+    _ff_hash_update(&hash, binary_data, data_len);
+    return _ff_hash_digest(&hash);
+}
+
+//------------------------------------------------------------------------------------------------------
+
+// fill the buffer unless at end of file, return bytes read, -1 : fail
+static ssize_t _ff_hash_read(int fd, unsigned char* buffer, size_t size)
+{
+    size_t sz = 0;
+    while (sz < size) {
+        ssize_t n = read(fd, buffer + sz, size - sz);
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        sz += (size_t)n;
+    }
+    return (ssize_t)sz;
+}
+
+int ff_get_type_and_hash_from_file(const char* file_path_and_name, FFType* type, unsigned long long* hash)
+{
+    *type = FFTypeUnknown;
+    if (strlen(file_path_and_name) < 1) {
+        return -1;
+    }
+    
+    FFProbe probe;
+    FFType ext_type = ff_probe_begin(&probe, file_path_and_name);
+    
+    int fd = open(file_path_and_name, O_RDONLY);
+    if (fd < 0) {
+        printf("Fail to open the file: %s!\n", file_path_and_name);
+        return -1;
+    }
+    
+    struct stat st;
+    unsigned char* buffer = g_ff_hash_buffer;
+    ssize_t sz = 0;
+    
+    if (0 != fstat(fd, &st)) {
+        close(fd);
+        return -1;
+    }
+    
+    // small file : one read covers it, st_size spares the read that would only see end of file
+    if (st.st_size < FF_HASH_SMALL_FILE) {
+        sz = read(fd, buffer, FF_HASH_SMALL_FILE);
+        if (sz >= 0 && sz < st.st_size) {
+            ssize_t rest = _ff_hash_read(fd, buffer + sz, FF_HASH_SMALL_FILE - (size_t)sz);
+            sz = rest < 0 ? -1 : sz + rest;
+        }
+    } else {
+        sz = _ff_hash_read(fd, buffer, FF_HASH_SMALL_FILE);
+    }
+    
+    if (sz >= 0) {
+        if (ext_type != FFTypeUnknown) {
+            *type = ext_type;
+        } else {
+            size_t probe_len = (size_t)sz < sizeof(probe.data) ? (size_t)sz : sizeof(probe.data);
+            memcpy(probe.data, buffer, probe_len);
+            *type = ff_probe_end(&probe, probe_len);
+        }
+        
+        FFHash state;
+        _ff_hash_init(&state);
+        _ff_hash_update(&state, buffer, (size_t)sz);
+        
+        // large file : stream the rest
+        while (sz == FF_HASH_SMALL_FILE) {
+            sz = _ff_hash_read(fd, buffer, FF_HASH_SMALL_FILE);
+            if (sz > 0) {
+                _ff_hash_update(&state, buffer, (size_t)sz);
+            }
+        }
+        
+        if (sz >= 0) {
+            *hash = _ff_hash_digest(&state);
+        }
+    }
+    
+    close(fd);
+    return sz >= 0 ? 0 : -1;
+}
@@ -0,0 +1,59 @@
+/*
+ MIT License
+
+Copyright (c) 2020 HenryKing
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef ff_hash_h
+#define ff_hash_h
+
+#include "ff_file_formats.h"
+
+/*
+ detection and an XXH64 content hash in one pass: files up to FF_HASH_SMALL_FILE are read with one
+ read() into a per-thread buffer, larger files are streamed in chunks of that size and the type is
+ matched on the first chunk
+ */
+
+#define FF_HASH_SMALL_FILE  (64 * 1024)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ hash : XXH64 with seed 0 of the whole file
+ return 0 : success; -1 : the file can not be opened or read, type and hash are not valid
+ */
+int ff_get_type_and_hash_from_file(const char* file_path_and_name, FFType* type, unsigned long long* hash);
+
+/*
+ XXH64 with seed 0
+ */
+unsigned long long ff_hash_data(const unsigned char* binary_data, size_t data_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ff_hash_h */
@@ -0,0 +1,378 @@
+/*
+ MIT License
+
+Copyright (c) 2020 HenryKing
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "ff_peek.h"
+
+#ifdef FF_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef FF_WITH_BZIP2
+#include <bzlib.h>
+#endif
+
+#ifdef FF_WITH_LZMA
+#include <lzma.h>
+#endif
+
+#ifdef FF_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#if defined(FF_WITH_ZLIB) || defined(FF_WITH_BZIP2) || defined(FF_WITH_LZMA) || defined(FF_WITH_ZSTD)
+#define FF_PEEK_HAS_DECODER 1
+#endif
+
+#define FF_PEEK_MAX_NAME    64
+#define FF_PEEK_ZLIB_ARENA  (48 * 1024) // inflate state + 32k window
+#define FF_PEEK_XZ_MEMLIMIT (9 * 1024 * 1024) // xz -6, the default, needs 8.1M; -7 .. -9 are left unknown
+#define FF_PEEK_ZSTD_WINDOW_LOG 23 // 8M window, zstd -19 and below; larger windows are left unknown
+
+typedef struct _FFPeekSource {
+    FILE* file;
+    
+    // pending input, handed out once before reading file
+    const unsigned char* data;
+    size_t data_len;
+    
+    unsigned char* chunk; // FF_PEEK_INPUT_SIZE
+    size_t total;
+}FFPeekSource;
+
+//------------------------------------------------------------------------------------------------------
+
+#ifdef FF_PEEK_HAS_DECODER
+// return bytes at *in; 0 : end of input
+static size_t _ff_peek_read(FFPeekSource* src, const unsigned char** in)
+{
+    size_t sz = 0;
+    if (src->data_len > 0) {
+        *in = src->data;
+        sz = src->data_len;
+        src->data_len = 0;
+    } else if (src->file != NULL && src->total < FF_PEEK_MAX_INPUT) {
+        *in = src->chunk;
+        sz = fread(src->chunk, 1, FF_PEEK_INPUT_SIZE, src->file);
+    }
+    
+    src->total += sz;
+    return sz;
+}
+#endif
+
+#ifdef FF_WITH_ZLIB
+typedef struct _FFPeekArena {
+    unsigned char* base;
+    size_t used;
+    size_t size;
+}FFPeekArena;
+
+// bump allocator on the stack, inflate allocates twice and frees at the end
+static voidpf _ff_peek_zalloc(voidpf opaque, uInt items, uInt size)
+{
+    FFPeekArena* arena = (FFPeekArena*)opaque;
+    size_t sz = ((size_t)items * size + 15) & ~(size_t)15;
+    if (sz > arena->size - arena->used) {
+        return Z_NULL;
+    }
+    
+    voidpf address = arena->base + arena->used;
+    arena->used += sz;
+    return address;
+}
+
+static void _ff_peek_zfree(voidpf opaque, voidpf address)
+{
+    (void)opaque;
+    (void)address;
+}
+
+static size_t _ff_peek_gz(FFPeekSource* src, unsigned char* out, size_t out_len)
+{
+    _Alignas(16) unsigned char memory[FF_PEEK_ZLIB_ARENA];
+    FFPeekArena arena = { memory, 0, sizeof(memory) };
+    
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    zs.zalloc = _ff_peek_zalloc;
+    zs.zfree = _ff_peek_zfree;
+    zs.opaque = &arena;
+    if (Z_OK != inflateInit2(&zs, 16 + MAX_WBITS)) {
+        return 0;
+    }
+    
+    zs.next_out = out;
+    zs.avail_out = (uInt)out_len;
+    
+    int ret = Z_OK;
+    while ((ret == Z_OK || ret == Z_BUF_ERROR) && zs.avail_out > 0) {
+        if (zs.avail_in == 0) {
+            const unsigned char* in = NULL;
+            size_t sz = _ff_peek_read(src, &in);
+            if (sz == 0) {
+                break;
+            }
+            zs.next_in = (Bytef*)in;
+            zs.avail_in = (uInt)sz;
+        }
+        ret = inflate(&zs, Z_NO_FLUSH);
+    }
+    
+    size_t sz = out_len - zs.avail_out;
+    inflateEnd(&zs);
+    return sz;
+}
+#endif
+
+#ifdef FF_WITH_BZIP2
+static size_t _ff_peek_bz2(FFPeekSource* src, unsigned char* out, size_t out_len)
+{
+    bz_stream bs;
+    memset(&bs, 0, sizeof(bs));
+    
+    // small : 2.5 bytes per block byte instead of 4
+    if (BZ_OK != BZ2_bzDecompressInit(&bs, 0, 1)) {
+        return 0;
+    }
+    
+    bs.next_out = (char*)out;
+    bs.avail_out = (unsigned int)out_len;
+    
+    int ret = BZ_OK;
+    while (ret == BZ_OK && bs.avail_out > 0) {
+        if (bs.avail_in == 0) {
+            const unsigned char* in = NULL;
+            size_t sz = _ff_peek_read(src, &in);
+            if (sz == 0) {
+                break;
+            }
+            bs.next_in = (char*)in;
+            bs.avail_in = (unsigned int)sz;
+        }
+        ret = BZ2_bzDecompress(&bs);
+    }
+    
+    size_t sz = out_len - bs.avail_out;
+    BZ2_bzDecompressEnd(&bs);
+    return sz;
+}
+#endif
+
+#ifdef FF_WITH_LZMA
+static size_t _ff_peek_xz(FFPeekSource* src, unsigned char* out, size_t out_len)
+{
+    // the dictionary is allocated in full, the memlimit fails the stream before that
+    lzma_stream ls = LZMA_STREAM_INIT;
+    if (LZMA_OK != lzma_stream_decoder(&ls, FF_PEEK_XZ_MEMLIMIT, 0)) {
+        return 0;
+    }
+    
+    ls.next_out = out;
+    ls.avail_out = out_len;
+    
+    lzma_ret ret = LZMA_OK;
+    while (ret == LZMA_OK && ls.avail_out > 0) {
+        if (ls.avail_in == 0) {
+            const unsigned char* in = NULL;
+            size_t sz = _ff_peek_read(src, &in);
+            if (sz == 0) {
+                break;
+            }
+            ls.next_in = in;
+            ls.avail_in = sz;
+        }
+        ret = lzma_code(&ls, LZMA_RUN);
+    }
+    
+    size_t sz = out_len - ls.avail_out;
+    lzma_end(&ls);
+    return sz;
+}
+#endif
+
+#ifdef FF_WITH_ZSTD
+static size_t _ff_peek_zst(FFPeekSource* src, unsigned char* out, size_t out_len)
+{
+    // the window is allocated in full as soon as the frame header is seen, cap it before
+    ZSTD_DCtx* ds = ZSTD_createDCtx();
+    if (ds == NULL) {
+        return 0;
+    }
+    if (ZSTD_isError(ZSTD_DCtx_setParameter(ds, ZSTD_d_windowLogMax, FF_PEEK_ZSTD_WINDOW_LOG))) {
+        ZSTD_freeDCtx(ds);
+        return 0;
+    }
+    
+    ZSTD_outBuffer output = { out, out_len, 0 };
+    ZSTD_inBuffer input = { NULL, 0, 0 };
+    while (output.pos < output.size) {
+        if (input.pos == input.size) {
+            const unsigned char* in = NULL;
+            size_t sz = _ff_peek_read(src, &in);
+            if (sz == 0) {
+                break;
+            }
+            input.src = in;
+            input.size = sz;
+            input.pos = 0;
+        }
+        
+        size_t ret = ZSTD_decompressStream(ds, &output, &input);
+        if (ZSTD_isError(ret) || ret == 0) {
+            break;
+        }
+    }
+    
+    ZSTD_freeDCtx(ds);
+    return output.pos;
+}
+#endif
+
+// return bytes decompressed into out, 0 if the decoder is not built in
+static size_t _ff_peek_decompress(FFType outer_type, FFPeekSource* src, unsigned char* out, size_t out_len)
+{
+    (void)src;
+    (void)out;
+    (void)out_len;
+    
+    switch (outer_type) {
+#ifdef FF_WITH_ZLIB
+        case FFTypeGZ:
+            return _ff_peek_gz(src, out, out_len);
+#endif
+#ifdef FF_WITH_BZIP2
+        case FFTypeBZ2:
+            return _ff_peek_bz2(src, out, out_len);
+#endif
+#ifdef FF_WITH_LZMA
+        case FFTypeXZ:
+            return _ff_peek_xz(src, out, out_len);
+#endif
+#ifdef FF_WITH_ZSTD
+        case FFTypeZST:
+            return _ff_peek_zst(src, out, out_len);
+#endif
+        default:
+            return 0;
+    }
+}
+
+// return 0 : false; 1 : true
+static int _ff_peek_is_compressed(FFType type)
+{
+    return type == FFTypeGZ || type == FFTypeBZ2 || type == FFTypeXZ || type == FFTypeZST;
+}
+
+// "a/b.tar.gz" -> "b.tar", the inner extension still hints the type
+static void _ff_peek_inner_name(const char* file_path_and_name, char* name, size_t name_size)
+{
+    size_t len = strlen(file_path_and_name);
+    const char* dot = strrchr(file_path_and_name, '.');
+    const char* slash = strrchr(file_path_and_name, '/');
+    if (dot != NULL && (slash == NULL || dot > slash)) {
+        len = (size_t)(dot - file_path_and_name);
+    }
+    
+    const char* start = len >= name_size ? file_path_and_name + len - (name_size - 1) : file_path_and_name;
+    size_t sz = (size_t)(file_path_and_name + len - start);
+    memcpy(name, start, sz);
+    name[sz] = '\0';
+}
+
+//------------------------------------------------------------------------------------------------------
+
+FFType ff_get_inner_type_from_file(const char* file_path_and_name, FFType* outer_type)
+{
+    if (outer_type != NULL) {
+        *outer_type = FFTypeUnknown;
+    }
+    
+    if (strlen(file_path_and_name) < 1) {
+        return FFTypeUnknown;
+    }
+    
+    FFProbe probe;
+    FFType type = ff_probe_begin(&probe, file_path_and_name);
+    if (type != FFTypeUnknown) {
+        return type;
+    }
+    
+    FILE* file = fopen(file_path_and_name, "rb");
+    if (file == NULL) {
+        printf("Fail to open the file: %s!\n", file_path_and_name);
+        return FFTypeUnknown;
+    }
+    
+    unsigned char chunk[FF_PEEK_INPUT_SIZE];
+    size_t sz = fread(chunk, 1, sizeof(chunk), file);
+    size_t probe_len = sz < sizeof(probe.data) ? sz : sizeof(probe.data);
+    memcpy(probe.data, chunk, probe_len);
+    type = ff_probe_end(&probe, probe_len);
+    
+    if (_ff_peek_is_compressed(type)) {
+        if (outer_type != NULL) {
+            *outer_type = type;
+        }
+        
+        char inner_name[FF_PEEK_MAX_NAME];
+        _ff_peek_inner_name(file_path_and_name, inner_name, sizeof(inner_name));
+        
+        FFProbe inner;
+        FFType inner_type = ff_probe_begin(&inner, inner_name);
+        if (inner_type == FFTypeUnknown) {
+            // the chunk is reused for further reads once the decoder has consumed it
+            FFPeekSource src = { file, chunk, sz, chunk, 0 };
+            size_t inner_len = _ff_peek_decompress(type, &src, inner.data, sizeof(inner.data));
+            
+            // nothing decoded (no decoder built in, corrupt stream, input cap), the inner extension alone is no proof
+            inner_type = inner_len > 0 ? ff_probe_end(&inner, inner_len) : FFTypeUnknown;
+        }
+        type = inner_type;
+    }
+    
+    fclose(file);
+    return type;
+}
+
+FFType ff_get_inner_type_from_data(unsigned char* binary_data, size_t data_len, FFType* outer_type)
+{
+    if (outer_type != NULL) {
+        *outer_type = FFTypeUnknown;
+    }
+    
+    FFType type = ff_get_type_from_data(binary_data, data_len);
+    if (!_ff_peek_is_compressed(type)) {
+        return type;
+    }
+    
+    if (outer_type != NULL) {
+        *outer_type = type;
+    }
+    
+    unsigned char inner[FF_PROBE_SIZE];
+    FFPeekSource src = { NULL, binary_data, data_len, NULL, 0 };
+    size_t sz = _ff_peek_decompress(type, &src, inner, sizeof(inner));
+    return sz > 0 ? ff_get_type_from_data(inner, sz) : FFTypeUnknown;
+}
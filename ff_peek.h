@@ -0,0 +1,64 @@
+/*
+ MIT License
+
+Copyright (c) 2020 HenryKing
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef ff_peek_h
+#define ff_peek_h
+
+#include "ff_file_formats.h"
+
+/*
+ peek through gzip / bzip2 / xz / zstd: decompress only the first FF_PROBE_SIZE bytes of the inner stream
+ into a fixed scratch buffer and classify them. the decoders are optional, build with
+ FF_WITH_ZLIB (-lz), FF_WITH_BZIP2 (-lbz2), FF_WITH_LZMA (-llzma), FF_WITH_ZSTD (-lzstd)
+ 
+ the decoder state is not bounded by the output but by the format, peak memory per call:
+ gzip 48k on the stack; bzip2 up to 2.3M (small mode, 900k blocks); xz up to 9M, streams that need
+ more (xz -7 .. -9) are FFTypeUnknown; zstd up to 8M window plus about 256k, larger windows are FFTypeUnknown
+ */
+
+#define FF_PEEK_INPUT_SIZE  4096
+#define FF_PEEK_MAX_INPUT   (1024 * 1024) // a bzip2 block is up to 900k before the first output byte
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ return the type of the inner stream. outer_type (may be NULL) receives the compression format,
+ or FFTypeUnknown if the file is not compressed, then the return value is the type of the file itself
+ */
+FFType ff_get_inner_type_from_file(const char* file_path_and_name, FFType* outer_type);
+
+/*
+ same as above for data read from file with offset 0, the inner stream is only decoded from binary_data
+ */
+FFType ff_get_inner_type_from_data(unsigned char* binary_data, size_t data_len, FFType* outer_type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ff_peek_h */
@@ -0,0 +1,190 @@
+/*
+ MIT License
+
+Copyright (c) 2020 HenryKing
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// pread, madvise; preadv, MADV_*
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "ff_range.h"
+
+typedef struct _FFRangeBatch {
+    unsigned char headers[FF_RANGE_BATCH][FF_PROBE_SIZE];
+    unsigned char gap[FF_RANGE_MAX_GAP]; // read through, never looked at
+    struct iovec iov[FF_RANGE_BATCH * 2];
+    size_t header_len[FF_RANGE_BATCH];
+}FFRangeBatch;
+
+//------------------------------------------------------------------------------------------------------
+
+static size_t _ff_range_header_len(const FFRange* range)
+{
+    return range->length < FF_PROBE_SIZE ? (size_t)range->length : FF_PROBE_SIZE;
+}
+
+// return the number of ranges from first covered by one preadv
+static size_t _ff_range_plan(FFRangeBatch* batch, const FFRange* ranges, size_t range_count, int* iov_count)
+{
+    size_t count = 0;
+    unsigned long long end = ranges[0].offset;
+    *iov_count = 0;
+    
+    while (count < range_count && count < FF_RANGE_BATCH) {
+        const FFRange* range = ranges + count;
+        
+        // out of order, overlapping or too far: next batch
+        if (count > 0 && (range->offset < end || range->offset - end > FF_RANGE_MAX_GAP)) {
+            break;
+        }
+        
+        if (range->offset > end) {
+            batch->iov[*iov_count].iov_base = batch->gap;
+            batch->iov[*iov_count].iov_len = (size_t)(range->offset - end);
+            (*iov_count)++;
+        }
+        
+        batch->header_len[count] = _ff_range_header_len(range);
+        batch->iov[*iov_count].iov_base = batch->headers[count];
+        batch->iov[*iov_count].iov_len = batch->header_len[count];
+        (*iov_count)++;
+        
+        end = range->offset + batch->header_len[count];
+        count++;
+    }
+    return count;
+}
+
+static int _ff_range_read(int fd, const FFRange* ranges, size_t range_count, FFType* types)
+{
+    FFRangeBatch* batch = (FFRangeBatch*)malloc(sizeof(FFRangeBatch));
+    if (batch == NULL) {
+        return -1;
+    }
+    
+    size_t done = 0;
+    while (done < range_count) {
+        int iov_count = 0;
+        size_t count = _ff_range_plan(batch, ranges + done, range_count - done, &iov_count);
+        
+        ssize_t sz = preadv(fd, batch->iov, iov_count, (off_t)ranges[done].offset);
+        if (sz < 0) {
+            free(batch);
+            return -1;
+        }
+        
+        // a short read at end of file leaves the later headers partial or empty
+        size_t left = (size_t)sz;
+        size_t object = 0;
+        for (int i = 0; i < iov_count; i++) {
+            size_t got = left < batch->iov[i].iov_len ? left : batch->iov[i].iov_len;
+            left -= got;
+            if (batch->iov[i].iov_base != batch->gap) {
+                types[done + object] = got > 0 ? ff_get_type_from_data(batch->headers[object], got) : FFTypeUnknown;
+                object++;
+            }
+        }
+        
+        done += count;
+    }
+    
+    free(batch);
+    return 0;
+}
+
+static void _ff_range_prefetch(unsigned char* base, size_t map_len, const FFRange* range, long page_size)
+{
+    if (range->offset >= map_len) {
+        return;
+    }
+    
+    size_t start = (size_t)range->offset & ~(size_t)(page_size - 1);
+    size_t end = (size_t)range->offset + _ff_range_header_len(range);
+    if (end > map_len) {
+        end = map_len;
+    }
+    madvise(base + start, end - start, MADV_WILLNEED);
+}
+
+static int _ff_range_map(int fd, const FFRange* ranges, size_t range_count, FFType* types)
+{
+    struct stat st;
+    if (0 != fstat(fd, &st)) {
+        return -1;
+    }
+    
+    size_t map_len = (size_t)st.st_size;
+    if (map_len == 0) {
+        for (size_t i = 0; i < range_count; i++) {
+            types[i] = FFTypeUnknown;
+        }
+        return 0;
+    }
+    
+    unsigned char* base = (unsigned char*)mmap(NULL, map_len, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+    
+    // only the header pages are wanted, no readahead around them
+    long page_size = sysconf(_SC_PAGESIZE);
+    madvise(base, map_len, MADV_RANDOM);
+    for (size_t i = 0; i < range_count && i < FF_RANGE_PREFETCH; i++) {
+        _ff_range_prefetch(base, map_len, ranges + i, page_size);
+    }
+    
+    for (size_t i = 0; i < range_count; i++) {
+        if (i + FF_RANGE_PREFETCH < range_count) {
+            _ff_range_prefetch(base, map_len, ranges + i + FF_RANGE_PREFETCH, page_size);
+        }
+        
+        const FFRange* range = ranges + i;
+        if (range->offset >= map_len) {
+            types[i] = FFTypeUnknown;
+            continue;
+        }
+        
+        size_t len = _ff_range_header_len(range);
+        if (len > map_len - range->offset) {
+            len = map_len - (size_t)range->offset;
+        }
+        types[i] = ff_get_type_from_data(base + range->offset, len);
+    }
+    
+    munmap(base, map_len);
+    return 0;
+}
+
+int ff_get_types_from_ranges(int fd, const FFRange* ranges, size_t range_count, FFRangeMode mode, FFType* types)
+{
+    if (range_count == 0) {
+        return 0;
+    }
+    
+    return mode == FFRangeMap ? _ff_range_map(fd, ranges, range_count, types) : _ff_range_read(fd, ranges, range_count, types);
+}
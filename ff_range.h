@@ -0,0 +1,65 @@
+/*
+ MIT License
+
+Copyright (c) 2020 HenryKing
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef ff_range_h
+#define ff_range_h
+
+#include "ff_file_formats.h"
+
+/*
+ classify objects packed in one large file (pack / segment / blob store) by (offset, length) ranges,
+ reading only the first FF_PROBE_SIZE bytes of every object
+ */
+
+typedef struct _FFRange {
+    unsigned long long offset;
+    unsigned long long length;
+}FFRange;
+
+typedef enum _FFRangeMode {
+    FFRangeRead = 0, // preadv, nearby headers batched into one call
+    FFRangeMap, // mmap with madvise hints, matched in place without copy
+}FFRangeMode;
+
+#define FF_RANGE_BATCH      64 // objects per preadv
+#define FF_RANGE_MAX_GAP    4096 // read through gaps up to a page, the device reads whole pages anyway
+#define FF_RANGE_PREFETCH   32 // objects the mapping asks ahead for
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ types[i] receives the type of ranges[i], ranges sorted by offset batch best into preadv calls
+ return 0 : success; -1 : fail
+ */
+int ff_get_types_from_ranges(int fd, const FFRange* ranges, size_t range_count, FFRangeMode mode, FFType* types);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ff_range_h */
@@ -0,0 +1,282 @@
+/*
+ MIT License
+
+Copyright (c) 2020 HenryKing
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// strdup
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "ff_sample.h"
+#include "ff_scan.h"
+
+#define FF_SAMPLE_STRATA    64 // by log2 of the file size
+#define FF_SAMPLE_POOL      4096 // candidates kept per stratum when max_samples is 0
+#define FF_SAMPLE_BATCH     256
+#define FF_SAMPLE_MIN       30 // per stratum (or all of it) before the first stop test, so z holds
+#define FF_SAMPLE_Z         1.96
+
+typedef struct _FFSampleFile {
+    char* path;
+    unsigned long long size;
+}FFSampleFile;
+
+typedef struct _FFSampleStratum {
+    // uniform reservoir of the stratum, [0, sampled) are drawn
+    FFSampleFile* pool;
+    size_t pool_count;
+    size_t pool_capacity;
+    
+    size_t count; // every file of the stratum
+    size_t sampled;
+    unsigned long long bytes;
+    
+    double type_count[FFTypeXCount];
+    double type_bytes[FFTypeXCount];
+    double type_bytes_sq[FFTypeXCount];
+}FFSampleStratum;
+
+typedef struct _FFSampleWalk {
+    FFSampleStratum* strata;
+    size_t pool_size;
+    unsigned long long* rng;
+    int fail;
+}FFSampleWalk;
+
+//------------------------------------------------------------------------------------------------------
+
+static int _ff_sample_stratum_index(unsigned long long size)
+{
+    int i = 0;
+    while (size > 0 && i < FF_SAMPLE_STRATA - 1) {
+        size >>= 1;
+        i++;
+    }
+    return i;
+}
+
+// splitmix64
+static unsigned long long _ff_sample_rand(unsigned long long* state)
+{
+    unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// only counts, bytes and a bounded reservoir per stratum are kept, not every path
+static void _ff_sample_collect(const char* path, const char* rel_path, const struct stat* st, void* ctx)
+{
+    (void)rel_path;
+    
+    FFSampleWalk* walk = (FFSampleWalk*)ctx;
+    if (walk->fail) {
+        return;
+    }
+    
+    unsigned long long size = (unsigned long long)st->st_size;
+    FFSampleStratum* stratum = walk->strata + _ff_sample_stratum_index(size);
+    stratum->count++;
+    stratum->bytes += size;
+    
+    // algorithm R : the k-th file replaces a random slot with probability pool_size / k
+    size_t slot = stratum->pool_count;
+    if (stratum->pool_count == walk->pool_size) {
+        slot = (size_t)(_ff_sample_rand(walk->rng) % stratum->count);
+        if (slot >= walk->pool_size) {
+            return;
+        }
+    }
+    
+    char* copy = strdup(path);
+    if (copy == NULL) {
+        walk->fail = 1;
+        return;
+    }
+    
+    if (slot == stratum->pool_count) {
+        if (stratum->pool_count == stratum->pool_capacity) {
+            size_t capacity = stratum->pool_capacity == 0 ? 64 : stratum->pool_capacity * 2;
+            if (capacity > walk->pool_size) {
+                capacity = walk->pool_size;
+            }
+            FFSampleFile* pool = (FFSampleFile*)realloc(stratum->pool, capacity * sizeof(FFSampleFile));
+            if (pool == NULL) {
+                free(copy);
+                walk->fail = 1;
+                return;
+            }
+            stratum->pool = pool;
+            stratum->pool_capacity = capacity;
+        }
+        stratum->pool_count++;
+    } else {
+        free(stratum->pool[slot].path);
+    }
+    
+    stratum->pool[slot].path = copy;
+    stratum->pool[slot].size = size;
+}
+
+// draw one file of the reservoir without replacement and read its header
+static void _ff_sample_draw(FFSampleStratum* stratum, unsigned long long* rng)
+{
+    size_t j = stratum->sampled + (size_t)(_ff_sample_rand(rng) % (stratum->pool_count - stratum->sampled));
+    FFSampleFile file = stratum->pool[j];
+    stratum->pool[j] = stratum->pool[stratum->sampled];
+    stratum->pool[stratum->sampled] = file;
+    stratum->sampled++;
+    
+    FFType type = ff_get_type_from_file(file.path);
+    double size = (double)file.size;
+    stratum->type_count[type] += 1;
+    stratum->type_bytes[type] += size;
+    stratum->type_bytes_sq[type] += size * size;
+}
+
+// stratified estimators with finite population correction. return 1 : every interval is within target
+static int _ff_sample_estimate(const FFSampleStratum* strata, double target_error, FFSampleResult* result)
+{
+    int done = 1;
+    for (int k = 0; k < FFTypeXCount; k++) {
+        double count = 0, count_var = 0, bytes = 0, bytes_var = 0;
+        
+        for (int h = 0; h < FF_SAMPLE_STRATA; h++) {
+            const FFSampleStratum* stratum = strata + h;
+            if (stratum->sampled == 0) {
+                continue;
+            }
+            
+            double N = (double)stratum->count;
+            double n = (double)stratum->sampled;
+            double fpc = 1 - n / N;
+            
+            double p = stratum->type_count[k] / n;
+            double mean = stratum->type_bytes[k] / n;
+            count += N * p;
+            bytes += N * mean;
+            
+            if (n > 1 && fpc > 0) {
+                // p = 0 or 1 would claim no variance, (x + 1) / (n + 2) keeps a type not yet drawn uncertain
+                double p_adj = (stratum->type_count[k] + 1) / (n + 2);
+                double p_var = p_adj * (1 - p_adj);
+                double size = (double)stratum->bytes / N;
+                double bytes_s2 = (stratum->type_bytes_sq[k] - n * mean * mean) / (n - 1);
+                if (bytes_s2 < p_var * size * size) {
+                    bytes_s2 = p_var * size * size;
+                }
+                count_var += N * N * fpc * (p_var * n / (n - 1)) / n;
+                bytes_var += N * N * fpc * bytes_s2 / n;
+            }
+        }
+        
+        FFSampleEstimate* estimate = result->estimates + k;
+        estimate->count = count;
+        estimate->count_error = FF_SAMPLE_Z * sqrt(count_var);
+        estimate->bytes = bytes;
+        estimate->bytes_error = FF_SAMPLE_Z * sqrt(bytes_var);
+        
+        if (estimate->count_error > target_error * (double)result->total_count ||
+            estimate->bytes_error > target_error * (double)result->total_bytes) {
+            done = 0;
+        }
+    }
+    return done;
+}
+
+int ff_sample_tree(const char* root, const FFSampleConfig* config, FFSampleResult* result)
+{
+    memset(result, 0, sizeof(FFSampleResult));
+    
+    FFSampleStratum* strata = (FFSampleStratum*)calloc(FF_SAMPLE_STRATA, sizeof(FFSampleStratum));
+    if (strata == NULL) {
+        return -1;
+    }
+    
+    unsigned long long rng = config->seed;
+    unsigned long long budget = config->max_samples;
+    
+    // no stratum can take more than the whole budget
+    FFSampleWalk walk = { strata, budget > 0 ? (size_t)budget : FF_SAMPLE_POOL, &rng, 0 };
+    if (walk.pool_size < FF_SAMPLE_MIN) {
+        walk.pool_size = FF_SAMPLE_MIN;
+    }
+    
+    int ret = ff_scan_shard(root, 0, 1, _ff_sample_collect, &walk);
+    if (ret != 0 || walk.fail) {
+        ret = -1;
+        goto end;
+    }
+    
+    for (int h = 0; h < FF_SAMPLE_STRATA; h++) {
+        result->total_count += strata[h].count;
+        result->total_bytes += strata[h].bytes;
+    }
+    if (budget == 0) {
+        budget = result->total_count;
+    }
+    
+    for (int h = 0; h < FF_SAMPLE_STRATA; h++) {
+        while (strata[h].sampled < strata[h].pool_count && strata[h].sampled < FF_SAMPLE_MIN && result->sampled < budget) {
+            _ff_sample_draw(strata + h, &rng);
+            result->sampled++;
+        }
+    }
+    
+    // each batch is split by the share of bytes plus the share of files of a stratum
+    while (!_ff_sample_estimate(strata, config->target_error, result) && result->sampled < budget) {
+        double weight_sum = 0;
+        double weights[FF_SAMPLE_STRATA] = { 0 };
+        for (int h = 0; h < FF_SAMPLE_STRATA; h++) {
+            if (strata[h].sampled < strata[h].pool_count) {
+                weights[h] = (double)strata[h].count / (double)result->total_count;
+                if (result->total_bytes > 0) {
+                    weights[h] += (double)strata[h].bytes / (double)result->total_bytes;
+                }
+                weight_sum += weights[h];
+            }
+        }
+        if (weight_sum <= 0) {
+            break;
+        }
+        
+        for (int h = 0; h < FF_SAMPLE_STRATA; h++) {
+            size_t want = (size_t)ceil(FF_SAMPLE_BATCH * weights[h] / weight_sum);
+            for (size_t i = 0; i < want && strata[h].sampled < strata[h].pool_count && result->sampled < budget; i++) {
+                _ff_sample_draw(strata + h, &rng);
+                result->sampled++;
+            }
+        }
+    }
+    
+end:
+    for (int h = 0; h < FF_SAMPLE_STRATA; h++) {
+        for (size_t i = 0; i < strata[h].pool_count; i++) {
+            free(strata[h].pool[i].path);
+        }
+        free(strata[h].pool);
+    }
+    free(strata);
+    return ret;
+}
@@ -0,0 +1,74 @@
+/*
+ MIT License
+
+Copyright (c) 2020 HenryKing
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef ff_sample_h
+#define ff_sample_h
+
+#include "ff_file_formats.h"
+
+/*
+ estimate the type mix of a tree: the walk only reads directory metadata, headers are read for a
+ random sample of files stratified by size, until the 95% confidence intervals are within target_error.
+ no stop test before every stratum has 30 files drawn (or all of them), proportions are shrunk to
+ (x + 1) / (n + 2) for the variance so a type not drawn yet still widens the interval
+ */
+
+typedef struct _FFSampleConfig {
+    double target_error; // half width of the 95% interval, relative to the total count and bytes, e.g. 0.01
+    unsigned long long max_samples; // 0 : no limit
+    unsigned long long seed;
+}FFSampleConfig;
+
+typedef struct _FFSampleEstimate {
+    double count;
+    double count_error; // 95% half width
+    double bytes;
+    double bytes_error;
+}FFSampleEstimate;
+
+typedef struct _FFSampleResult {
+    // exact, from the metadata walk
+    unsigned long long total_count;
+    unsigned long long total_bytes;
+    
+    unsigned long long sampled;
+    FFSampleEstimate estimates[FFTypeXCount];
+}FFSampleResult;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ return 0 : success; -1 : fail
+ */
+int ff_sample_tree(const char* root, const FFSampleConfig* config, FFSampleResult* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ff_sample_h */
@@ -0,0 +1,383 @@
+/*
+ MIT License
+
+Copyright (c) 2020 HenryKing
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// lstat, strdup, getline, ssize_t; d_type
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include <dirent.h>
+#include <stdlib.h>
+
+#include "ff_scan.h"
+
+#define FF_SCAN_MAX_PATH    4096
+#define FF_SCAN_UNKNOWN_EXT "-"
+
+typedef struct _FFScanWalk {
+    char path[FF_SCAN_MAX_PATH];
+    size_t root_len;
+    
+    unsigned int shard_index;
+    unsigned int shard_count;
+    
+    FFScanFunc func;
+    void* ctx;
+}FFScanWalk;
+
+typedef struct _FFScanRecord {
+    char* rel_path;
+    FFType type;
+    unsigned long long size;
+}FFScanRecord;
+
+typedef struct _FFScanShard {
+    FFScanRecord* records;
+    size_t count;
+    size_t capacity;
+    int fail;
+}FFScanShard;
+
+//------------------------------------------------------------------------------------------------------
+
+// FNV-1a, stable across hosts and runs
+static unsigned long long _ff_scan_hash(const char* str)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    for (; *str != '\0'; str++) {
+        hash ^= (unsigned char)*str;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static const char* _ff_scan_rel_path(const FFScanWalk* walk, size_t path_len)
+{
+    if (path_len <= walk->root_len) {
+        return "";
+    }
+    return walk->path + walk->root_len + 1;
+}
+
+static void _ff_scan_dir(FFScanWalk* walk, size_t path_len)
+{
+    DIR* dir = opendir(walk->path[0] != '\0' ? walk->path : "/");
+    if (dir == NULL) {
+        printf("Fail to open the directory: %s!\n", walk->path);
+        return;
+    }
+    
+    int is_owned = _ff_scan_hash(_ff_scan_rel_path(walk, path_len)) % walk->shard_count == walk->shard_index;
+    
+    struct dirent* entry = NULL;
+    while ((entry = readdir(dir)) != NULL) {
+        const char* name = entry->d_name;
+        if (0 == strcmp(name, ".") || 0 == strcmp(name, "..")) {
+            continue;
+        }
+        
+        size_t name_len = strlen(name);
+        if (path_len + name_len + 2 > FF_SCAN_MAX_PATH) {
+            printf("The path is too long: %s/%s!\n", walk->path, name);
+            continue;
+        }
+        
+        // -1 : unknown, 0 : file, 1 : directory
+        int is_dir = -1;
+#ifdef DT_DIR
+        if (entry->d_type == DT_DIR) {
+            is_dir = 1;
+        } else if (entry->d_type == DT_REG) {
+            is_dir = 0;
+        } else if (entry->d_type != DT_UNKNOWN) {
+            continue;
+        }
+#endif
+        // the files of other shards are not even stat-ed
+        if (is_dir == 0 && !is_owned) {
+            continue;
+        }
+        
+        walk->path[path_len] = '/';
+        memcpy(walk->path + path_len + 1, name, name_len + 1);
+        size_t child_len = path_len + 1 + name_len;
+        
+        struct stat st;
+        if (is_dir == 1) {
+            _ff_scan_dir(walk, child_len);
+        } else if (0 == lstat(walk->path, &st)) {
+            if (S_ISDIR(st.st_mode)) {
+                _ff_scan_dir(walk, child_len);
+            } else if (S_ISREG(st.st_mode) && is_owned) {
+                walk->func(walk->path, _ff_scan_rel_path(walk, child_len), &st, walk->ctx);
+            }
+        }
+        
+        walk->path[path_len] = '\0';
+    }
+    
+    closedir(dir);
+}
+
+int ff_scan_shard(const char* root, unsigned int shard_index, unsigned int shard_count, FFScanFunc func, void* ctx)
+{
+    if (shard_count == 0 || shard_index >= shard_count || func == NULL) {
+        return -1;
+    }
+    
+    size_t root_len = strlen(root);
+    while (root_len > 0 && root[root_len - 1] == '/') {
+        root_len--;
+    }
+    if (root_len + 1 > FF_SCAN_MAX_PATH) {
+        return -1;
+    }
+    
+    FFScanWalk* walk = (FFScanWalk*)malloc(sizeof(FFScanWalk));
+    if (walk == NULL) {
+        return -1;
+    }
+    
+    memcpy(walk->path, root, root_len);
+    walk->path[root_len] = '\0';
+    walk->root_len = root_len;
+    walk->shard_index = shard_index;
+    walk->shard_count = shard_count;
+    walk->func = func;
+    walk->ctx = ctx;
+    
+    _ff_scan_dir(walk, root_len);
+    
+    free(walk);
+    return 0;
+}
+
+//------------------------------------------------------------------------------------------------------
+// SHARD FILE
+
+static void _ff_scan_collect(const char* path, const char* rel_path, const struct stat* st, void* ctx)
+{
+    FFScanShard* shard = (FFScanShard*)ctx;
+    if (shard->fail) {
+        return;
+    }
+    
+    // one record per line
+    if (strchr(rel_path, '\n') != NULL) {
+        printf("Skip the file with a line break in its name: %s!\n", path);
+        return;
+    }
+    
+    if (shard->count == shard->capacity) {
+        size_t capacity = shard->capacity == 0 ? 1024 : shard->capacity * 2;
+        FFScanRecord* records = (FFScanRecord*)realloc(shard->records, capacity * sizeof(FFScanRecord));
+        if (records == NULL) {
+            shard->fail = 1;
+            return;
+        }
+        shard->records = records;
+        shard->capacity = capacity;
+    }
+    
+    FFScanRecord* record = shard->records + shard->count;
+    record->rel_path = strdup(rel_path);
+    if (record->rel_path == NULL) {
+        shard->fail = 1;
+        return;
+    }
+    record->type = ff_get_type_from_file(path);
+    record->size = (unsigned long long)st->st_size;
+    shard->count++;
+}
+
+static int _ff_scan_compare_record(const void* a, const void* b)
+{
+    return strcmp(((const FFScanRecord*)a)->rel_path, ((const FFScanRecord*)b)->rel_path);
+}
+
+static const char* _ff_scan_ext(FFType type)
+{
+    return type == FFTypeUnknown ? FF_SCAN_UNKNOWN_EXT : ff_get_ext_name_by_type(type);
+}
+
+static FFType _ff_scan_type_by_ext(const char* ext)
+{
+    for (int i = 1; i < FFTypeXCount; i++) {
+        if (i != FFTypeCount && 0 == strcmp(ext, ff_get_ext_name_by_type((FFType)i))) {
+            return (FFType)i;
+        }
+    }
+    return FFTypeUnknown;
+}
+
+int ff_scan_write_shard(const char* root, unsigned int shard_index, unsigned int shard_count, const char* out_path)
+{
+    FFScanShard shard = { NULL, 0, 0, 0 };
+    int ret = ff_scan_shard(root, shard_index, shard_count, _ff_scan_collect, &shard);
+    
+    // write to a temporary file, so a crashed worker never leaves a half shard behind
+    char tmp_path[FF_SCAN_MAX_PATH];
+    if (ret == 0 && !shard.fail && (size_t)snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", out_path) < sizeof(tmp_path)) {
+        qsort(shard.records, shard.count, sizeof(FFScanRecord), _ff_scan_compare_record);
+        
+        FILE* file = fopen(tmp_path, "w");
+        if (file == NULL) {
+            printf("Fail to open the file: %s!\n", tmp_path);
+            ret = -1;
+        } else {
+            for (size_t i = 0; i < shard.count; i++) {
+                FFScanRecord* record = shard.records + i;
+                fprintf(file, "%s\t%llu\t%s\n", _ff_scan_ext(record->type), record->size, record->rel_path);
+            }
+            
+            if (0 != fclose(file) || 0 != rename(tmp_path, out_path)) {
+                remove(tmp_path);
+                ret = -1;
+            }
+        }
+    } else {
+        ret = -1;
+    }
+    
+    for (size_t i = 0; i < shard.count; i++) {
+        free(shard.records[i].rel_path);
+    }
+    free(shard.records);
+    return ret;
+}
+
+//------------------------------------------------------------------------------------------------------
+// MERGE
+
+typedef struct _FFScanInput {
+    FILE* file;
+    char* line;
+    size_t line_cap;
+    ssize_t line_len;
+    const char* rel_path;
+}FFScanInput;
+
+// return 0 : end of file; 1 : got a line, without its '\n' so rel_path compares as the shard sorted it
+static int _ff_scan_next_line(FFScanInput* input)
+{
+    while ((input->line_len = getline(&input->line, &input->line_cap, input->file)) > 0) {
+        if (input->line[input->line_len - 1] == '\n') {
+            input->line[--input->line_len] = '\0';
+        }
+        
+        char* size = strchr(input->line, '\t');
+        char* rel_path = size != NULL ? strchr(size + 1, '\t') : NULL;
+        if (rel_path != NULL) {
+            input->rel_path = rel_path + 1;
+            return 1;
+        }
+    }
+    input->rel_path = NULL;
+    return 0;
+}
+
+static void _ff_scan_count_line(const char* line, FFScanStats* stats)
+{
+    const char* tab = strchr(line, '\t');
+    char ext[8] = { 0 };
+    size_t ext_len = (size_t)(tab - line);
+    if (ext_len >= sizeof(ext)) {
+        return;
+    }
+    memcpy(ext, line, ext_len);
+    
+    FFType type = _ff_scan_type_by_ext(ext);
+    stats->count[type]++;
+    stats->bytes[type] += strtoull(tab + 1, NULL, 10);
+}
+
+int ff_scan_merge(const char* out_path, const char* const* shard_paths, size_t shard_path_count, FFScanStats* stats)
+{
+    FFScanInput* inputs = (FFScanInput*)calloc(shard_path_count, sizeof(FFScanInput));
+    if (inputs == NULL) {
+        return -1;
+    }
+    
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(FFScanStats));
+    }
+    
+    int ret = 0;
+    for (size_t i = 0; i < shard_path_count; i++) {
+        inputs[i].file = fopen(shard_paths[i], "r");
+        if (inputs[i].file == NULL) {
+            printf("Fail to open the file: %s!\n", shard_paths[i]);
+            ret = -1;
+            break;
+        }
+        _ff_scan_next_line(inputs + i);
+    }
+    
+    // write to a temporary file as the shards, so a crashed merge never leaves a half index behind
+    char tmp_path[FF_SCAN_MAX_PATH];
+    if (ret == 0 && (size_t)snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", out_path) >= sizeof(tmp_path)) {
+        ret = -1;
+    }
+    
+    FILE* out = ret == 0 ? fopen(tmp_path, "w") : NULL;
+    if (ret == 0 && out == NULL) {
+        printf("Fail to open the file: %s!\n", tmp_path);
+        ret = -1;
+    }
+    
+    // k-way merge, every shard is already sorted
+    while (ret == 0) {
+        FFScanInput* min_input = NULL;
+        for (size_t i = 0; i < shard_path_count; i++) {
+            if (inputs[i].rel_path != NULL && (min_input == NULL || strcmp(inputs[i].rel_path, min_input->rel_path) < 0)) {
+                min_input = inputs + i;
+            }
+        }
+        if (min_input == NULL) {
+            break;
+        }
+        
+        fwrite(min_input->line, 1, (size_t)min_input->line_len, out);
+        fputc('\n', out);
+        if (stats != NULL) {
+            _ff_scan_count_line(min_input->line, stats);
+        }
+        _ff_scan_next_line(min_input);
+    }
+    
+    if (out != NULL) {
+        if (0 != fclose(out) || ret != 0 || 0 != rename(tmp_path, out_path)) {
+            remove(tmp_path);
+            ret = -1;
+        }
+    }
+    
+    for (size_t i = 0; i < shard_path_count; i++) {
+        if (inputs[i].file != NULL) {
+            fclose(inputs[i].file);
+        }
+        free(inputs[i].line);
+    }
+    free(inputs);
+    return ret;
+}
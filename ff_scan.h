@@ -0,0 +1,72 @@
+/*
+ MIT License
+
+Copyright (c) 2020 HenryKing
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#ifndef ff_scan_h
+#define ff_scan_h
+
+#include <sys/stat.h>
+
+#include "ff_file_formats.h"
+
+typedef struct _FFScanStats {
+    unsigned long long count[FFTypeXCount];
+    unsigned long long bytes[FFTypeXCount];
+}FFScanStats;
+
+/*
+ path : root joined with rel_path, rel_path : relative to root
+ */
+typedef void (*FFScanFunc)(const char* path, const char* rel_path, const struct stat* st, void* ctx);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ walk every directory under root, call func for the regular files of the directories owned by this shard.
+ a directory belongs to shard (hash(relative directory path) % shard_count), so shard_count independent
+ processes with the same root and shard_count cover the tree exactly once.
+ return 0 : success; -1 : fail
+ */
+int ff_scan_shard(const char* root, unsigned int shard_index, unsigned int shard_count, FFScanFunc func, void* ctx);
+
+/*
+ detect the files of one shard and write them to out_path, sorted by relative path.
+ one line per file: EXT \t size \t rel_path ("-" for unknown types)
+ return 0 : success; -1 : fail
+ */
+int ff_scan_write_shard(const char* root, unsigned int shard_index, unsigned int shard_count, const char* out_path);
+
+/*
+ merge sorted shard files into one sorted index, stats may be NULL
+ return 0 : success; -1 : fail
+ */
+int ff_scan_merge(const char* out_path, const char* const* shard_paths, size_t shard_path_count, FFScanStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ff_scan_h */
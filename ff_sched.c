@@ -0,0 +1,438 @@
+/*
+ MIT License
+
+Copyright (c) 2020 HenryKing
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// clock_gettime, nanosleep; syscall
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "ff_sched.h"
+#include "ff_scan.h"
+
+#define FF_SCHED_READ_COST      4096 // a header read costs the device at least one page
+#define FF_SCHED_BURST_SEC      0.1
+#define FF_SCHED_LATENCY_ALPHA  0.2
+#define FF_SCHED_QUEUE_SIZE     256 // paths waiting per device, the walk blocks when full
+#define FF_SCHED_MAX_THREADS    64 // readers of all devices
+
+#define FF_IOPRIO_WHO_PROCESS   1 // with pid 0 : the calling thread
+#define FF_IOPRIO_CLASS_IDLE    3
+#define FF_IOPRIO_CLASS_SHIFT   13
+
+typedef struct _FFSchedBucket {
+    double rate; // 0 : no limit
+    double burst;
+    double tokens;
+}FFSchedBucket;
+
+typedef struct _FFSchedDevice {
+    dev_t dev;
+    struct _FFSchedDevice* next;
+    
+    // ring of paths from the walk
+    char* queue[FF_SCHED_QUEUE_SIZE];
+    size_t head;
+    size_t count;
+    int closed; // no more paths
+    
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    
+    FFSchedBucket ops;
+    FFSchedBucket bytes;
+    double refill_time;
+    
+    // adaptive concurrency
+    unsigned int limit;
+    unsigned int inflight;
+    unsigned int good_reads;
+    unsigned int workers;
+    double latency_ms;
+    double decrease_time;
+}FFSchedDevice;
+
+typedef struct _FFSchedWorker {
+    struct _FFSchedScan* scan;
+    FFSchedDevice* device;
+}FFSchedWorker;
+
+typedef struct _FFSchedScan {
+    const char* root;
+    const FFSchedConfig* config;
+    
+    FFSchedDevice* devices; // only the walk adds to the list
+    int walk_ret;
+    int fail;
+    
+    // readers are created lazily, up to FF_SCHED_MAX_THREADS
+    pthread_mutex_t thread_mutex;
+    pthread_t threads[FF_SCHED_MAX_THREADS];
+    FFSchedWorker workers[FF_SCHED_MAX_THREADS];
+    size_t thread_count;
+    int threads_closed;
+    
+    pthread_mutex_t func_mutex;
+    FFSchedFunc func;
+    void* ctx;
+}FFSchedScan;
+
+//------------------------------------------------------------------------------------------------------
+
+static double _ff_sched_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void _ff_sched_sleep(double seconds)
+{
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+}
+
+static void _ff_sched_bucket_init(FFSchedBucket* bucket, double rate, double cost)
+{
+    bucket->rate = rate;
+    bucket->burst = rate * FF_SCHED_BURST_SEC > cost ? rate * FF_SCHED_BURST_SEC : cost;
+    bucket->tokens = bucket->burst;
+}
+
+static void _ff_sched_bucket_refill(FFSchedBucket* bucket, double elapsed)
+{
+    bucket->tokens += bucket->rate * elapsed;
+    if (bucket->tokens > bucket->burst) {
+        bucket->tokens = bucket->burst;
+    }
+}
+
+// return seconds to wait until cost is available, 0 : taken
+static double _ff_sched_bucket_take(FFSchedBucket* bucket, double cost)
+{
+    if (bucket->rate <= 0) {
+        return 0;
+    }
+    if (bucket->tokens < cost) {
+        return (cost - bucket->tokens) / bucket->rate;
+    }
+    bucket->tokens -= cost;
+    return 0;
+}
+
+// cost : bytes charged with the op, called with device->mutex held, returns with it held
+static void _ff_sched_wait_tokens(FFSchedDevice* device, double cost)
+{
+    for (;;) {
+        double now = _ff_sched_now();
+        _ff_sched_bucket_refill(&device->ops, now - device->refill_time);
+        _ff_sched_bucket_refill(&device->bytes, now - device->refill_time);
+        device->refill_time = now;
+        
+        double wait = 0;
+        if (device->ops.rate > 0 && device->ops.tokens < 1) {
+            wait = (1 - device->ops.tokens) / device->ops.rate;
+        } else {
+            wait = _ff_sched_bucket_take(&device->bytes, cost);
+            if (wait == 0) {
+                _ff_sched_bucket_take(&device->ops, 1);
+                return;
+            }
+        }
+        
+        pthread_mutex_unlock(&device->mutex);
+        _ff_sched_sleep(wait);
+        pthread_mutex_lock(&device->mutex);
+    }
+}
+
+// AIMD on the reads in flight, called with device->mutex held
+static void _ff_sched_update_latency(FFSchedDevice* device, const FFSchedConfig* config, double latency_ms)
+{
+    device->latency_ms = device->latency_ms == 0 ? latency_ms : device->latency_ms + FF_SCHED_LATENCY_ALPHA * (latency_ms - device->latency_ms);
+    if (config->target_latency_ms <= 0) {
+        return;
+    }
+    
+    double now = _ff_sched_now();
+    if (device->latency_ms > config->target_latency_ms) {
+        // at most once per smoothed latency, the reads already in flight were issued at the old limit
+        if ((now - device->decrease_time) * 1000 > device->latency_ms) {
+            device->limit = device->limit > 1 ? device->limit / 2 : 1;
+            device->decrease_time = now;
+        }
+        device->good_reads = 0;
+    } else if (++device->good_reads >= device->limit) {
+        if (device->limit < config->max_concurrency) {
+            device->limit++;
+        }
+        device->good_reads = 0;
+    }
+}
+
+static void _ff_sched_set_idle_class(void)
+{
+#ifdef __linux__
+    syscall(SYS_ioprio_set, FF_IOPRIO_WHO_PROCESS, 0, FF_IOPRIO_CLASS_IDLE << FF_IOPRIO_CLASS_SHIFT);
+#endif
+}
+
+// one header read, called with device->mutex held and inflight taken, returns with it held
+static void _ff_sched_read(FFSchedScan* scan, FFSchedDevice* device, char* path)
+{
+    _ff_sched_wait_tokens(device, FF_SCHED_READ_COST);
+    pthread_mutex_unlock(&device->mutex);
+    
+    double start = _ff_sched_now();
+    FFType type = ff_get_type_from_file(path);
+    double latency_ms = (_ff_sched_now() - start) * 1000;
+    
+    pthread_mutex_lock(&device->mutex);
+    device->inflight--;
+    _ff_sched_update_latency(device, scan->config, latency_ms);
+    pthread_cond_broadcast(&device->cond);
+    pthread_mutex_unlock(&device->mutex);
+    
+    if (scan->func != NULL) {
+        pthread_mutex_lock(&scan->func_mutex);
+        scan->func(path, type, scan->ctx);
+        pthread_mutex_unlock(&scan->func_mutex);
+    }
+    free(path);
+    
+    pthread_mutex_lock(&device->mutex);
+}
+
+static void* _ff_sched_worker(void* arg);
+
+// start one more reader while the device allows more reads in flight than it has readers,
+// called with device->mutex held. return 0 : started; -1 : not
+static int _ff_sched_spawn(FFSchedScan* scan, FFSchedDevice* device)
+{
+    if (device->workers >= device->limit) {
+        return -1;
+    }
+    
+    int ret = -1;
+    pthread_mutex_lock(&scan->thread_mutex);
+    if (!scan->threads_closed && scan->thread_count < FF_SCHED_MAX_THREADS) {
+        FFSchedWorker* worker = scan->workers + scan->thread_count;
+        worker->scan = scan;
+        worker->device = device;
+        if (0 == pthread_create(scan->threads + scan->thread_count, NULL, _ff_sched_worker, worker)) {
+            scan->thread_count++;
+            device->workers++;
+            ret = 0;
+        }
+    }
+    pthread_mutex_unlock(&scan->thread_mutex);
+    return ret;
+}
+
+static void* _ff_sched_worker(void* arg)
+{
+    FFSchedWorker* worker = (FFSchedWorker*)arg;
+    FFSchedScan* scan = worker->scan;
+    FFSchedDevice* device = worker->device;
+    
+    if (scan->config->idle_class) {
+        _ff_sched_set_idle_class();
+    }
+    
+    pthread_mutex_lock(&device->mutex);
+    for (;;) {
+        while (device->count == 0 ? !device->closed : device->inflight >= device->limit) {
+            pthread_cond_wait(&device->cond, &device->mutex);
+        }
+        if (device->count == 0) {
+            break;
+        }
+        
+        char* path = device->queue[device->head];
+        device->head = (device->head + 1) % FF_SCHED_QUEUE_SIZE;
+        device->count--;
+        device->inflight++;
+        pthread_cond_broadcast(&device->cond);
+        
+        _ff_sched_read(scan, device, path);
+        
+        // the limit may have grown past the readers of the device
+        _ff_sched_spawn(scan, device);
+    }
+    pthread_mutex_unlock(&device->mutex);
+    
+    return NULL;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+static FFSchedDevice* _ff_sched_device(FFSchedScan* scan, dev_t dev)
+{
+    FFSchedDevice* device = scan->devices;
+    for (; device != NULL; device = device->next) {
+        if (device->dev == dev) {
+            return device;
+        }
+    }
+    
+    // never moved, the readers keep a pointer to it
+    device = (FFSchedDevice*)calloc(1, sizeof(FFSchedDevice));
+    if (device == NULL) {
+        return NULL;
+    }
+    device->dev = dev;
+    pthread_mutex_init(&device->mutex, NULL);
+    pthread_cond_init(&device->cond, NULL);
+    
+    const FFSchedConfig* config = scan->config;
+    _ff_sched_bucket_init(&device->ops, config->iops, 1);
+    _ff_sched_bucket_init(&device->bytes, config->bytes_per_sec, FF_SCHED_READ_COST);
+    device->refill_time = _ff_sched_now();
+    
+    // slow start when backing off is on
+    device->limit = config->target_latency_ms > 0 ? 1 : config->max_concurrency;
+    
+    device->next = scan->devices;
+    scan->devices = device;
+    return device;
+}
+
+// on the walk thread : the paths go to the queue of their device while walking
+static void _ff_sched_queue(const char* path, const char* rel_path, const struct stat* st, void* ctx)
+{
+    (void)rel_path;
+    
+    FFSchedScan* scan = (FFSchedScan*)ctx;
+    if (scan->fail) {
+        return;
+    }
+    
+    FFSchedDevice* device = _ff_sched_device(scan, st->st_dev);
+    char* copy = device != NULL ? strdup(path) : NULL;
+    if (copy == NULL) {
+        scan->fail = 1;
+        return;
+    }
+    
+    pthread_mutex_lock(&device->mutex);
+    
+    // the lstat which found the file is one op of the device too
+    _ff_sched_wait_tokens(device, 0);
+    
+    if (device->workers == 0 && 0 != _ff_sched_spawn(scan, device)) {
+        // no reader left for a new device, read it here
+        device->inflight++;
+        _ff_sched_read(scan, device, copy);
+        pthread_mutex_unlock(&device->mutex);
+        return;
+    }
+    
+    while (device->count == FF_SCHED_QUEUE_SIZE) {
+        pthread_cond_wait(&device->cond, &device->mutex);
+    }
+    device->queue[(device->head + device->count) % FF_SCHED_QUEUE_SIZE] = copy;
+    device->count++;
+    _ff_sched_spawn(scan, device);
+    pthread_cond_broadcast(&device->cond);
+    pthread_mutex_unlock(&device->mutex);
+}
+
+static void* _ff_sched_walk(void* arg)
+{
+    FFSchedScan* scan = (FFSchedScan*)arg;
+    
+    if (scan->config->idle_class) {
+        _ff_sched_set_idle_class();
+    }
+    scan->walk_ret = ff_scan_shard(scan->root, 0, 1, _ff_sched_queue, scan);
+    
+    return NULL;
+}
+
+int ff_sched_scan(const char* root, const FFSchedConfig* config, FFSchedFunc func, void* ctx)
+{
+    if (config->max_concurrency == 0) {
+        return -1;
+    }
+    
+    FFSchedScan* scan = (FFSchedScan*)calloc(1, sizeof(FFSchedScan));
+    if (scan == NULL) {
+        return -1;
+    }
+    scan->root = root;
+    scan->config = config;
+    scan->func = func;
+    scan->ctx = ctx;
+    pthread_mutex_init(&scan->thread_mutex, NULL);
+    pthread_mutex_init(&scan->func_mutex, NULL);
+    
+    // the walk gets its own thread, so the idle class does not stick to the caller
+    int ret = 0;
+    pthread_t walk_thread;
+    if (0 == pthread_create(&walk_thread, NULL, _ff_sched_walk, scan)) {
+        pthread_join(walk_thread, NULL);
+        ret = scan->walk_ret != 0 || scan->fail ? -1 : 0;
+    } else {
+        ret = -1;
+    }
+    
+    FFSchedDevice* device = scan->devices;
+    for (; device != NULL; device = device->next) {
+        pthread_mutex_lock(&device->mutex);
+        device->closed = 1;
+        pthread_cond_broadcast(&device->cond);
+        pthread_mutex_unlock(&device->mutex);
+    }
+    
+    // no reader is started after this, so thread_count is final
+    pthread_mutex_lock(&scan->thread_mutex);
+    scan->threads_closed = 1;
+    pthread_mutex_unlock(&scan->thread_mutex);
+    
+    for (size_t i = 0; i < scan->thread_count; i++) {
+        pthread_join(scan->threads[i], NULL);
+    }
+    
+    while (scan->devices != NULL) {
+        device = scan->devices;
+        scan->devices = device->next;
+        pthread_mutex_destroy(&device->mutex);
+        pthread_cond_destroy(&device->cond);
+        free(device);
+    }
+    pthread_mutex_destroy(&scan->thread_mutex);
+    pthread_mutex_destroy(&scan->func_mutex);
+    
+    free(scan);
+    return ret;
+}
@@ -0,0 +1,66 @@
+/*
+ MIT License
+
+Copyright (c) 2020 HenryKing
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef ff_sched_h
+#define ff_sched_h
+
+#include "ff_file_formats.h"
+
+/*
+ bulk scan on live storage: the files are queued per device (st_dev), every device has its own
+ token bucket for reads and bytes, and its own number of reads in flight, which is halved when
+ the smoothed read latency goes above target and grows by one per window of good reads.
+ the walk feeds bounded per-device queues from its own thread and its lstat calls take ops
+ from the same buckets; readers are started lazily, at most 64 in total
+ */
+
+typedef struct _FFSchedConfig {
+    double iops; // reads per second per device, 0 : no limit
+    double bytes_per_sec; // per device, 0 : no limit
+    unsigned int max_concurrency; // reads in flight per device
+    double target_latency_ms; // 0 : never back off
+    int idle_class; // 1 : the walk and the readers use the idle I/O class (Linux ioprio)
+}FFSchedConfig;
+
+/*
+ called from the reader threads, one call at a time
+ */
+typedef void (*FFSchedFunc)(const char* path, FFType type, void* ctx);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ return 0 : success; -1 : fail
+ */
+int ff_sched_scan(const char* root, const FFSchedConfig* config, FFSchedFunc func, void* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ff_sched_h */
@@ -1,6 +1,189 @@
 //
 
 #include "ff_file_formats.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ff_entropy.h"
+#include "ff_hash.h"
+#include "ff_peek.h"
+#include "ff_range.h"
+#include "ff_sample.h"
+#include "ff_scan.h"
+#include "ff_sched.h"
+
+static void print_scanned_file(const char* path, FFType type, void* ctx)
+{
+    (void)ctx;
+    printf("%s\t%s\n", type == FFTypeUnknown ? "-" : ff_get_ext_name_by_type(type), path);
+}
+
+/*
+ --hash <file>                        : type and XXH64 of the content from one pass
+ --meta <file>                        : type plus dimensions / channels / sample rate from the same read
+ --peek <file>                        : detect the type inside gzip / bzip2 / xz / zstd
+ --ranges <file> <read|map> <offset>:<length>... : types of objects packed in one file
+ --sample <root> [error]             : estimate the type mix from a sample, error defaults to 0.01
+ --scan <root> [iops] [bytes/s] [concurrency] [latency ms] : throttled scan in the idle I/O class
+ --shard <index>/<count> <root> <out> : detect the files of one shard, write a sorted shard file
+ --merge <out> <shard>...             : merge shard files into one index, print per type statistics
+ */
+static int option_main(int argc, const char* argv[])
+{
+    if (argc >= 3 && 0 == strcmp(argv[1], "--hash")) {
+        FFType type = FFTypeUnknown;
+        unsigned long long hash = 0;
+        if (0 != ff_get_type_and_hash_from_file(argv[2], &type, &hash)) {
+            printf("Fail to hash the file: %s!\n", argv[2]);
+            return 1;
+        }
+        printf("%s\t%016llx\t%s\n", type == FFTypeUnknown ? "-" : ff_get_ext_name_by_type(type), hash, argv[2]);
+        return 0;
+    }
+    
+    if (argc >= 3 && 0 == strcmp(argv[1], "--meta")) {
+        FFMeta meta;
+        FFType type = ff_get_type_and_meta_from_file(argv[2], FF_META_MAX_PROBE_SIZE, &meta);
+        if (type == FFTypeUnknown) {
+            printf("Fail to get the file type!\n");
+        } else {
+            printf("The file type is: %s! width %u, height %u, channels %u, bits %u, sample rate %u\n", ff_get_ext_name_by_type(type),
+                   meta.width, meta.height, meta.channels, meta.bits, meta.sample_rate);
+        }
+        return 0;
+    }
+    
+    if (argc >= 3 && 0 == strcmp(argv[1], "--peek")) {
+        FFType outer_type = FFTypeUnknown;
+        FFType type = ff_get_inner_type_from_file(argv[2], &outer_type);
+        if (type == FFTypeUnknown && outer_type == FFTypeUnknown) {
+            printf("Fail to get the file type!\n");
+        } else if (outer_type != FFTypeUnknown) {
+            printf("The file type is: %s inside %s!\n", type == FFTypeUnknown ? "?" : ff_get_ext_name_by_type(type), ff_get_ext_name_by_type(outer_type));
+        } else {
+            printf("The file type is: %s!\n", ff_get_ext_name_by_type(type));
+        }
+        return 0;
+    }
+    
+    if (argc >= 5 && 0 == strcmp(argv[1], "--ranges")) {
+        FFRangeMode mode = FFRangeRead;
+        if (0 == strcmp(argv[3], "map")) {
+            mode = FFRangeMap;
+        } else if (0 != strcmp(argv[3], "read")) {
+            printf("The mode should be read or map!\n");
+            return 1;
+        }
+        
+        size_t range_count = (size_t)(argc - 4);
+        FFRange* ranges = (FFRange*)calloc(range_count, sizeof(FFRange));
+        FFType* types = (FFType*)calloc(range_count, sizeof(FFType));
+        int fd = -1;
+        int ret = 0;
+        if (ranges == NULL || types == NULL) {
+            printf("Fail to allocate %zu ranges!\n", range_count);
+            ret = 1;
+        } else if ((fd = open(argv[2], O_RDONLY)) < 0) {
+            printf("Fail to open the file: %s!\n", argv[2]);
+            ret = 1;
+        }
+        
+        for (size_t i = 0; ret == 0 && i < range_count; i++) {
+            if (2 != sscanf(argv[i + 4], "%llu:%llu", &ranges[i].offset, &ranges[i].length)) {
+                printf("The range should be <offset>:<length>!\n");
+                ret = 1;
+            }
+        }
+        
+        if (ret == 0 && 0 != ff_get_types_from_ranges(fd, ranges, range_count, mode, types)) {
+            printf("Fail to read the ranges of: %s!\n", argv[2]);
+            ret = 1;
+        }
+        
+        for (size_t i = 0; ret == 0 && i < range_count; i++) {
+            printf("%llu\t%llu\t%s\n", ranges[i].offset, ranges[i].length,
+                   types[i] == FFTypeUnknown ? "-" : ff_get_ext_name_by_type(types[i]));
+        }
+        
+        if (fd >= 0) {
+            close(fd);
+        }
+        free(ranges);
+        free(types);
+        return ret;
+    }
+    
+    if (argc >= 3 && 0 == strcmp(argv[1], "--sample")) {
+        FFSampleConfig config = { argc >= 4 ? atof(argv[3]) : 0.01, 0, (unsigned long long)time(NULL) };
+        FFSampleResult result;
+        if (0 != ff_sample_tree(argv[2], &config, &result)) {
+            printf("Fail to sample the directory: %s!\n", argv[2]);
+            return 1;
+        }
+        
+        printf("Sampled %llu of %llu files, %llu bytes\n", result.sampled, result.total_count, result.total_bytes);
+        for (int i = 0; i < FFTypeXCount; i++) {
+            const FFSampleEstimate* estimate = result.estimates + i;
+            if (estimate->count > 0) {
+                const char* ext = i == FFTypeUnknown ? "-" : ff_get_ext_name_by_type((FFType)i);
+                printf("%-5s %12.0f +- %-10.0f files %16.0f +- %-14.0f bytes\n", ext,
+                       estimate->count, estimate->count_error, estimate->bytes, estimate->bytes_error);
+            }
+        }
+        return 0;
+    }
+    
+    if (argc >= 3 && 0 == strcmp(argv[1], "--scan")) {
+        FFSchedConfig config = {
+            argc >= 4 ? atof(argv[3]) : 0,
+            argc >= 5 ? atof(argv[4]) : 0,
+            argc >= 6 ? (unsigned int)atoi(argv[5]) : 4,
+            argc >= 7 ? atof(argv[6]) : 0,
+            1,
+        };
+        if (0 != ff_sched_scan(argv[2], &config, print_scanned_file, NULL)) {
+            printf("Fail to scan the directory: %s!\n", argv[2]);
+            return 1;
+        }
+        return 0;
+    }
+    
+    if (argc >= 5 && 0 == strcmp(argv[1], "--shard")) {
+        unsigned int shard_index = 0;
+        unsigned int shard_count = 0;
+        if (2 != sscanf(argv[2], "%u/%u", &shard_index, &shard_count) || shard_index >= shard_count) {
+            printf("The shard should be <index>/<count>, and index < count!\n");
+            return 1;
+        }
+        
+        if (0 != ff_scan_write_shard(argv[3], shard_index, shard_count, argv[4])) {
+            printf("Fail to write the shard: %s!\n", argv[4]);
+            return 1;
+        }
+        return 0;
+    }
+    
+    if (argc >= 4 && 0 == strcmp(argv[1], "--merge")) {
+        FFScanStats stats;
+        if (0 != ff_scan_merge(argv[2], argv + 3, (size_t)(argc - 3), &stats)) {
+            printf("Fail to merge the shards into: %s!\n", argv[2]);
+            return 1;
+        }
+        
+        for (int i = 0; i < FFTypeXCount; i++) {
+            if (stats.count[i] > 0) {
+                const char* ext = i == FFTypeUnknown ? "-" : ff_get_ext_name_by_type((FFType)i);
+                printf("%-5s %12llu files %16llu bytes\n", ext, stats.count[i], stats.bytes[i]);
+            }
+        }
+        return 0;
+    }
+    
+    printf("Please supply the file path and name as the first argument!\n");
+    return 1;
+}
 
 int main(int argc, const char* argv[]) {
     if (argc < 2 ) {
@@ -20,11 +203,36 @@ int main(int argc, const char* argv[]) {
         return 0;
     }
     
+    if (argv[1][0] == '-' && argv[1][1] == '-') {
+        return option_main(argc, argv);
+    }
+    
     const char* file_name = argv[1];
     
-    FFType type = ff_get_type_from_file(file_name);
+    // one read serves both the signature and, when it matches nothing, the entropy class
+    FFProbe probe;
+    size_t sz = 0;
+    FFType type = ff_probe_begin(&probe, file_name);
+    if (type == FFTypeUnknown) {
+        FILE* file = fopen(file_name, "r");
+        if (file == NULL) {
+            printf("Fail to open the file: %s!\n", file_name);
+            return 0;
+        }
+        sz = fread(probe.data, 1, sizeof(probe.data), file);
+        fclose(file);
+        
+        type = ff_probe_end(&probe, sz);
+    }
+    
     if (type == FFTypeUnknown) {
         printf("Fail to get the file type!\n");
+        
+        FFEntropy entropy;
+        if (FFEntropyUnknown != ff_get_entropy_from_data(probe.data, sz, &entropy)) {
+            printf("The data looks %s (score %.2f, %.2f bits per byte)!\n",
+                   ff_get_entropy_class_name(entropy.entropy_class), entropy.score, entropy.entropy);
+        }
     } else {
         const char* ext = ff_get_ext_name_by_type(type);
         printf("The file type is: %s!\n", ext);